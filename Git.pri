@@ -1,48 +1,90 @@
 INCLUDEPATH += $$PWD
 
+LIBS += -lz
+
 HEADERS += \
     $$PWD/AGitProcess.h \
+    $$PWD/FileStamp.h \
+    $$PWD/GitAncestry.h \
     $$PWD/GitAsyncProcess.h \
     $$PWD/GitBase.h \
+    $$PWD/GitBitmapIndex.h \
     $$PWD/GitBranches.h \
     $$PWD/GitCloneProcess.h \
+    $$PWD/GitCommitGraph.h \
     $$PWD/GitConfig.h \
+    $$PWD/GitConfigDatabase.h \
     $$PWD/GitCredentials.h \
     $$PWD/GitExecResult.h \
+    $$PWD/GitFetchScheduler.h \
     $$PWD/GitHistory.h \
     $$PWD/GitLocal.h \
     $$PWD/GitMerge.h \
+    $$PWD/GitMultiPackIndex.h \
+    $$PWD/GitNetworkProcess.h \
+    $$PWD/GitObjectDatabase.h \
+    $$PWD/GitPackFile.h \
     $$PWD/GitPatches.h \
+    $$PWD/GitProgressParser.h \
+    $$PWD/GitRefDatabase.h \
+    $$PWD/GitRefSnapshot.h \
+    $$PWD/GitRefTransaction.h \
     $$PWD/GitRemote.h \
+    $$PWD/GitRemoteUrl.h \
+    $$PWD/GitRenameDetector.h \
+    $$PWD/GitRepositoryWatcher.h \
     $$PWD/GitRequestorProcess.h \
     $$PWD/GitStashes.h \
     $$PWD/GitSubmodules.h \
     $$PWD/GitSubtree.h \
     $$PWD/GitSyncProcess.h \
     $$PWD/GitTags.h \
+    $$PWD/GitTreeDiff.h \
     $$PWD/GitWip.h \
+    $$PWD/IntralineDiff.h \
+    $$PWD/ObjectId.h \
+    $$PWD/ParallelFor.h \
     $$PWD/RevisionFiles.h \
     $$PWD/WipRevisionInfo.h
 
 SOURCES += \
     $$PWD/AGitProcess.cpp \
+    $$PWD/GitAncestry.cpp \
     $$PWD/GitAsyncProcess.cpp \
     $$PWD/GitBase.cpp \
+    $$PWD/GitBitmapIndex.cpp \
     $$PWD/GitBranches.cpp \
     $$PWD/GitCloneProcess.cpp \
+    $$PWD/GitCommitGraph.cpp \
     $$PWD/GitConfig.cpp \
+    $$PWD/GitConfigDatabase.cpp \
     $$PWD/GitCredentials.cpp \
     $$PWD/GitExecResult.cpp \
+    $$PWD/GitFetchScheduler.cpp \
     $$PWD/GitHistory.cpp \
     $$PWD/GitLocal.cpp \
     $$PWD/GitMerge.cpp \
+    $$PWD/GitMultiPackIndex.cpp \
+    $$PWD/GitNetworkProcess.cpp \
+    $$PWD/GitObjectDatabase.cpp \
+    $$PWD/GitPackFile.cpp \
     $$PWD/GitPatches.cpp \
+    $$PWD/GitProgressParser.cpp \
+    $$PWD/GitRefDatabase.cpp \
+    $$PWD/GitRefSnapshot.cpp \
+    $$PWD/GitRefTransaction.cpp \
     $$PWD/GitRemote.cpp \
+    $$PWD/GitRemoteUrl.cpp \
+    $$PWD/GitRenameDetector.cpp \
+    $$PWD/GitRepositoryWatcher.cpp \
     $$PWD/GitRequestorProcess.cpp \
     $$PWD/GitStashes.cpp \
     $$PWD/GitSubmodules.cpp \
     $$PWD/GitSubtree.cpp \
     $$PWD/GitSyncProcess.cpp \
     $$PWD/GitTags.cpp \
+    $$PWD/GitTreeDiff.cpp \
     $$PWD/GitWip.cpp \
+    $$PWD/IntralineDiff.cpp \
+    $$PWD/ObjectId.cpp \
     $$PWD/RevisionFiles.cpp
@@ -0,0 +1,616 @@
+#include "GitAncestry.h"
+
+#include <GitBase.h>
+#include <GitBitmapIndex.h>
+#include <GitCommitGraph.h>
+#include <GitObjectDatabase.h>
+#include <GitRefDatabase.h>
+
+#include <FileStamp.h>
+#include <QLogger.h>
+
+#include <QDirIterator>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QtAlgorithms>
+
+#include <limits>
+#include <queue>
+#include <utility>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr int MAX_MEMO_SIZE = 100000;
+// Commits read from the object database before the question is given to git
+constexpr int MAX_OBJECT_WALK = 10000;
+
+// Commits are immutable, so an answer for a pair of SHAs stays valid as long as nothing changes the parents git sees
+struct RepositoryMemo
+{
+   qint64 packedRefsStamp = -2;
+   bool packedReplaceRefs = false;
+   QHash<QPair<ObjectId, ObjectId>, bool> answers;
+};
+
+QMutex memoMutex;
+QHash<QString, RepositoryMemo> memos;
+
+// Shallow clones, grafts and replace refs change the parents git sees, and reading the commits gives other answers.
+// Reftable repositories can't be checked for replace refs without git.
+bool hasRewrittenParents(const QString &commonDir, const GitRefDatabase &refs, RepositoryMemo &memo)
+{
+   if (!refs.isSupported() || QFile::exists(commonDir + "/shallow") || QFile::exists(commonDir + "/info/grafts"))
+      return true;
+
+   if (QDirIterator(commonDir + "/refs/replace", QDir::Files, QDirIterator::Subdirectories).hasNext())
+      return true;
+
+   const auto packedRefs = commonDir + "/packed-refs";
+
+   if (const auto stamp = fileStamp(packedRefs); stamp != memo.packedRefsStamp)
+   {
+      QFile file(packedRefs);
+
+      memo.packedReplaceRefs = file.open(QIODevice::ReadOnly) && file.readAll().contains(" refs/replace/");
+      memo.packedRefsStamp = stamp;
+   }
+
+   return memo.packedReplaceRefs;
+}
+}
+
+GitAncestry::GitAncestry(const QSharedPointer<GitBase> &gitBase)
+   : mGitBase(gitBase)
+{
+}
+
+bool GitAncestry::isAncestor(const QString &ancestor, const QString &descendant) const
+{
+   return areAncestors({ ancestor }, descendant).constFirst();
+}
+
+bool GitAncestry::isAncestor(const ObjectId &ancestor, const ObjectId &descendant) const
+{
+   return !descendant.isNull() && areAncestors(QVector<ObjectId> { ancestor }, descendant).constFirst();
+}
+
+QVector<bool> GitAncestry::areAncestors(const QStringList &candidates, const QString &descendant) const
+{
+   QLog_Debug("Git", QString("Checking {%1} candidate ancestors of {%2}").arg(candidates.count()).arg(descendant));
+
+   const auto descendantId = resolveCommit(descendant);
+
+   if (descendantId.isNull())
+      return QVector<bool>(candidates.count(), false);
+
+   QVector<ObjectId> ids;
+   ids.reserve(candidates.count());
+
+   for (const auto &candidate : candidates)
+      ids.append(resolveCommit(candidate));
+
+   return areAncestors(ids, descendantId);
+}
+
+QVector<bool> GitAncestry::areAncestors(const QVector<ObjectId> &candidates, const ObjectId &descendant) const
+{
+   QVector<bool> answers(candidates.count(), false);
+   const auto commonDir = mGitBase->getGitCommonDir();
+   QSet<ObjectId> pending;
+   auto rewritten = false;
+
+   {
+      QMutexLocker lock(&memoMutex);
+
+      auto &memo = memos[commonDir];
+      rewritten = hasRewrittenParents(commonDir, *mGitBase->getRefDatabase(), memo);
+
+      if (rewritten)
+         memo.answers.clear();
+
+      for (const auto &id : candidates)
+      {
+         if (!rewritten && !id.isNull() && !memo.answers.contains(qMakePair(id, descendant)))
+            pending.insert(id);
+      }
+   }
+
+   // The answers can change with the parents, so they are neither walked nor remembered
+   if (rewritten)
+   {
+      for (auto i = 0; i < candidates.count(); ++i)
+         answers[i] = !candidates.at(i).isNull() && isAncestorByGit(candidates.at(i), descendant);
+
+      return answers;
+   }
+
+   if (!pending.isEmpty())
+   {
+      QSet<ObjectId> found;
+
+      if (!walk(descendant, pending, found))
+      {
+         for (const auto &id : std::as_const(pending))
+         {
+            if (isAncestorByGit(id, descendant))
+               found.insert(id);
+         }
+      }
+
+      QMutexLocker lock(&memoMutex);
+      auto &memo = memos[commonDir];
+
+      if (memo.answers.count() + pending.count() > MAX_MEMO_SIZE)
+         memo.answers.clear();
+
+      for (const auto &id : std::as_const(pending))
+         memo.answers.insert(qMakePair(id, descendant), found.contains(id));
+   }
+
+   QMutexLocker lock(&memoMutex);
+   const auto &memo = memos[commonDir];
+
+   for (auto i = 0; i < candidates.count(); ++i)
+      answers[i] = !candidates.at(i).isNull() && memo.answers.value(qMakePair(candidates.at(i), descendant), false);
+
+   return answers;
+}
+
+QVector<bool> GitAncestry::isAncestorOf(const QString &ancestor, const QStringList &descendants) const
+{
+   QVector<bool> answers;
+   answers.reserve(descendants.count());
+
+   for (const auto &descendant : descendants)
+      answers.append(isAncestor(ancestor, descendant));
+
+   return answers;
+}
+
+bool GitAncestry::countCommits(const QString &from, const QStringList &excluded, qint64 &count) const
+{
+   return countByBitmap(from, excluded, false, count) || countByGit(from, excluded, false, count);
+}
+
+bool GitAncestry::aheadBehind(const QString &local, const QString &upstream, qint64 &ahead, qint64 &behind) const
+{
+   if (countByBitmap(local, { upstream }, false, ahead, &behind))
+      return true;
+
+   return countByGit(local, { upstream }, false, ahead) && countByGit(upstream, { local }, false, behind);
+}
+
+bool GitAncestry::aheadBehind(const QStringList &tips, const QString &base,
+                              QVector<QPair<qint64, qint64>> &counts) const
+{
+   const auto commitGraph = mGitBase->getCommitGraph();
+   const auto objectDatabase = mGitBase->getObjectDatabase();
+   const auto baseId = resolveCommit(base);
+
+   // Without generation numbers nothing guarantees a commit is counted after all its descendants
+   if (!commitGraph || baseId.isNull())
+      return false;
+
+   QLog_Debug("Git", QString("Counting ahead/behind of {%1} tips against {%2}").arg(tips.count()).arg(base));
+
+   // Commits are keyed by their graph position. The ones written after the graph get keys above any position.
+   constexpr quint64 OUTSIDE_GRAPH = quint64(1) << 32;
+
+   QHash<ObjectId, quint64> outsideKeys;
+   QHash<quint64, QVector<quint64>> outsideParents;
+   QHash<quint64, quint64> outsideGenerations;
+   QVector<ObjectId> pendingIds;
+
+   const auto keyOf = [&](const ObjectId &id) {
+      if (const auto pos = commitGraph->findCommit(id); pos != GitCommitGraph::NO_POSITION)
+         return static_cast<quint64>(pos);
+
+      if (const auto iter = outsideKeys.constFind(id); iter != outsideKeys.cend())
+         return iter.value();
+
+      const auto key = OUTSIDE_GRAPH + static_cast<quint64>(outsideKeys.count());
+      outsideKeys.insert(id, key);
+      pendingIds.append(id);
+
+      return key;
+   };
+
+   QVector<quint64> tipKeys;
+   tipKeys.reserve(tips.count());
+
+   for (const auto &tip : tips)
+      tipKeys.append(keyOf(ObjectId::fromString(tip)));
+
+   const auto baseKey = keyOf(baseId);
+
+   while (!pendingIds.isEmpty())
+   {
+      const auto id = pendingIds.takeLast();
+      const auto object = objectDatabase->read(id);
+
+      if (object.type != GitObjectDatabase::ObjectType::Commit)
+      {
+         QLog_Debug("Git", QString("Commit {%1} can't be read in-process").arg(id.toString()));
+         return false;
+      }
+
+      QVector<quint64> parentKeys;
+      const auto parents = GitObjectDatabase::parseCommit(object.data).parents;
+
+      for (const auto &parent : parents)
+         parentKeys.append(keyOf(parent));
+
+      outsideParents.insert(outsideKeys.value(id), parentKeys);
+   }
+
+   const auto generationOf = [&](quint64 key) {
+      return key < OUTSIDE_GRAPH ? commitGraph->generation(static_cast<quint32>(key)) : outsideGenerations.value(key);
+   };
+
+   // The new commits are above everything in the graph: one more than their highest parent
+   for (auto iter = outsideParents.cbegin(); iter != outsideParents.cend(); ++iter)
+   {
+      QVector<quint64> stack { iter.key() };
+
+      while (!stack.isEmpty())
+      {
+         const auto key = stack.constLast();
+
+         if (outsideGenerations.contains(key))
+         {
+            stack.removeLast();
+            continue;
+         }
+
+         quint64 generation = 0;
+         auto ready = true;
+
+         for (const auto parent : outsideParents.value(key))
+         {
+            if (parent >= OUTSIDE_GRAPH && !outsideGenerations.contains(parent))
+            {
+               stack.append(parent);
+               ready = false;
+            }
+            else
+               generation = qMax(generation, generationOf(parent));
+         }
+
+         if (ready)
+         {
+            outsideGenerations.insert(key, generation + 1);
+            stack.removeLast();
+         }
+      }
+   }
+
+   // One flag per tip plus the last one for the base. Commits are taken by decreasing generation, so their flags are
+   // complete when they come out of the queue. The walk ends when every queued commit is reachable from everything.
+   const auto flagCount = tips.count() + 1;
+   const auto wordCount = (flagCount + 63) / 64;
+   QVector<quint64> allFlags(wordCount, ~quint64(0));
+
+   if (flagCount % 64)
+      allFlags.last() = (quint64(1) << (flagCount % 64)) - 1;
+
+   QHash<quint64, QVector<quint64>> flags;
+   std::priority_queue<QPair<quint64, quint64>> queue;
+   auto active = 0;
+
+   const auto addFlags = [&](quint64 key, const QVector<quint64> &added) {
+      auto iter = flags.find(key);
+
+      if (iter == flags.end())
+      {
+         flags.insert(key, added);
+         queue.push(qMakePair(generationOf(key), key));
+
+         if (added != allFlags)
+            ++active;
+
+         return;
+      }
+
+      const auto wasComplete = iter.value() == allFlags;
+
+      for (auto i = 0; i < wordCount; ++i)
+         iter.value()[i] |= added.at(i);
+
+      if (!wasComplete && iter.value() == allFlags)
+         --active;
+   };
+
+   const auto singleFlag = [wordCount](int flag) {
+      QVector<quint64> words(wordCount, 0);
+      words[flag / 64] = quint64(1) << (flag % 64);
+
+      return words;
+   };
+
+   for (auto i = 0; i < tipKeys.count(); ++i)
+      addFlags(tipKeys.at(i), singleFlag(i));
+
+   addFlags(baseKey, singleFlag(tips.count()));
+
+   counts = QVector<QPair<qint64, qint64>>(tips.count(), qMakePair(qint64(0), qint64(0)));
+
+   while (active > 0 && !queue.empty())
+   {
+      const auto key = queue.top().second;
+      queue.pop();
+
+      const auto commitFlags = flags.take(key);
+
+      if (commitFlags != allFlags)
+      {
+         --active;
+
+         // Tips reaching a commit the base doesn't reach are ahead of it, and the other way around
+         const auto inBase = (commitFlags.at(tips.count() / 64) >> (tips.count() % 64)) & 1;
+
+         for (auto word = 0; word < wordCount; ++word)
+         {
+            auto bits = (inBase ? ~commitFlags.at(word) : commitFlags.at(word)) & allFlags.at(word);
+
+            while (bits)
+            {
+               const auto tip = word * 64 + static_cast<int>(qCountTrailingZeroBits(bits));
+               bits &= bits - 1;
+
+               if (inBase)
+                  ++counts[tip].second;
+               else
+                  ++counts[tip].first;
+            }
+         }
+      }
+
+      if (key < OUTSIDE_GRAPH)
+      {
+         const auto parents = commitGraph->parents(static_cast<quint32>(key));
+
+         for (const auto parent : parents)
+            addFlags(parent, commitFlags);
+      }
+      else
+      {
+         const auto parents = outsideParents.value(key);
+
+         for (const auto parent : parents)
+            addFlags(parent, commitFlags);
+      }
+   }
+
+   return true;
+}
+
+bool GitAncestry::countObjects(const QString &from, const QStringList &excluded, qint64 &count) const
+{
+   return countByBitmap(from, excluded, true, count) || countByGit(from, excluded, true, count);
+}
+
+ObjectId GitAncestry::resolveCommit(const QString &name) const
+{
+   if (const auto id = ObjectId::fromString(name); !id.isNull())
+      return id;
+
+   // Branches, tags and HEAD are read from the ref files. Only the rest of the revision syntax goes to git.
+   if (const auto refs = mGitBase->getRefDatabase(); refs->isSupported())
+   {
+      if (const auto ref = refs->resolveShortName(name); ref.isValid())
+      {
+         auto id = ObjectId::fromString(ref.peeledSha.isEmpty() ? ref.sha : ref.peeledSha);
+         const auto objectDatabase = mGitBase->getObjectDatabase();
+
+         // Annotated tags can point to other tags
+         for (auto depth = 0; depth < 16 && !id.isNull(); ++depth)
+         {
+            const auto object = objectDatabase->read(id);
+
+            if (object.type == GitObjectDatabase::ObjectType::Commit)
+               return id;
+
+            id = object.type == GitObjectDatabase::ObjectType::Tag ? GitObjectDatabase::parseTag(object.data).object
+                                                                    : ObjectId();
+         }
+      }
+   }
+
+   const auto ret = mGitBase->run(QString("git rev-parse --verify -q %1^{commit}").arg(name));
+
+   return ret.success ? ObjectId::fromString(ret.output.trimmed()) : ObjectId();
+}
+
+bool GitAncestry::walk(const ObjectId &descendant, const QSet<ObjectId> &targets, QSet<ObjectId> &found) const
+{
+   const auto commitGraph = mGitBase->getCommitGraph();
+   const auto objectDatabase = mGitBase->getObjectDatabase();
+
+   // Targets in the graph are matched by position, and nothing below the lowest generation among them can reach them.
+   // The ones outside the graph are newer than it, so only the commits outside the graph can reach them.
+   QHash<quint32, ObjectId> graphTargets;
+   QSet<ObjectId> otherTargets;
+   auto minGeneration = std::numeric_limits<quint64>::max();
+
+   for (const auto &target : targets)
+   {
+      const auto pos = commitGraph ? commitGraph->findCommit(target) : GitCommitGraph::NO_POSITION;
+
+      if (pos != GitCommitGraph::NO_POSITION)
+      {
+         graphTargets.insert(pos, target);
+         minGeneration = qMin(minGeneration, commitGraph->generation(pos));
+      }
+      else
+         otherTargets.insert(target);
+   }
+
+   // Commits newer than the commit-graph are read from the object database until the walk enters the graph
+   QVector<ObjectId> pendingIds;
+   QVector<quint32> pendingPositions;
+   QSet<ObjectId> visitedIds;
+   QSet<quint32> visitedPositions;
+   auto foundOtherTargets = 0;
+
+   const auto push = [&](const ObjectId &id) {
+      const auto pos = commitGraph ? commitGraph->findCommit(id) : GitCommitGraph::NO_POSITION;
+
+      if (pos != GitCommitGraph::NO_POSITION)
+         pendingPositions.append(pos);
+      else
+         pendingIds.append(id);
+   };
+
+   push(descendant);
+
+   while (found.count() < targets.count() && (!pendingIds.isEmpty() || !pendingPositions.isEmpty()))
+   {
+      if (!pendingIds.isEmpty())
+      {
+         const auto id = pendingIds.takeLast();
+
+         if (visitedIds.contains(id))
+            continue;
+
+         visitedIds.insert(id);
+
+         // Without a commit-graph the walk could read the whole history
+         if (visitedIds.count() > MAX_OBJECT_WALK)
+         {
+            QLog_Debug("Git", QString("Walk from {%1} too long to do in-process").arg(descendant.toString()));
+            return false;
+         }
+
+         if (otherTargets.contains(id) && !found.contains(id))
+         {
+            found.insert(id);
+            ++foundOtherTargets;
+         }
+
+         const auto object = objectDatabase->read(id);
+
+         if (object.type != GitObjectDatabase::ObjectType::Commit)
+         {
+            QLog_Debug("Git", QString("Commit {%1} can't be read in-process").arg(id.toString()));
+            return false;
+         }
+
+         const auto parents = GitObjectDatabase::parseCommit(object.data).parents;
+
+         for (const auto &parent : parents)
+            push(parent);
+      }
+      else
+      {
+         // Once in the graph only its targets can still be found
+         if (found.count() - foundOtherTargets == graphTargets.count())
+            break;
+
+         const auto pos = pendingPositions.takeLast();
+
+         if (visitedPositions.contains(pos))
+            continue;
+
+         visitedPositions.insert(pos);
+
+         if (const auto iter = graphTargets.constFind(pos); iter != graphTargets.cend())
+            found.insert(iter.value());
+
+         if (commitGraph->generation(pos) <= minGeneration)
+            continue;
+
+         const auto parents = commitGraph->parents(pos);
+
+         for (const auto parent : parents)
+            pendingPositions.append(parent);
+      }
+   }
+
+   return true;
+}
+
+bool GitAncestry::isAncestorByGit(const ObjectId &ancestor, const ObjectId &descendant) const
+{
+   // merge-base --is-ancestor only answers through the exit code, which runNetwork takes as the result. It can walk
+   // the whole history, so it runs without the fixed timeout too.
+   const auto cmd = QString("git merge-base --is-ancestor %1 %2").arg(ancestor.toString(), descendant.toString());
+
+   return mGitBase->runNetwork(cmd).success;
+}
+
+bool GitAncestry::countByBitmap(const QString &from, const QStringList &excluded, bool withObjects, qint64 &count,
+                                qint64 *reverseCount) const
+{
+   const auto objectDatabase = mGitBase->getObjectDatabase();
+   const auto bitmapIndex = objectDatabase->bitmapIndex();
+
+   if (!bitmapIndex)
+      return false;
+
+   const auto fromId = resolveCommit(from);
+   QVector<ObjectId> excludedIds;
+
+   for (const auto &name : excluded)
+      excludedIds.append(resolveCommit(name));
+
+   if (fromId.isNull() || excludedIds.contains(ObjectId()))
+      return false;
+
+   GitBitmapIndex::Bitmap fromBitmap;
+   GitBitmapIndex::Bitmap excludedBitmap;
+   QSet<ObjectId> fromOutside;
+   QSet<ObjectId> excludedOutside;
+
+   if (!bitmapIndex->reachable({ fromId }, *objectDatabase, withObjects, fromBitmap, fromOutside)
+       || !bitmapIndex->reachable(excludedIds, *objectDatabase, withObjects, excludedBitmap, excludedOutside))
+   {
+      return false;
+   }
+
+   if (withObjects)
+   {
+      // Trees and blobs of commits newer than the pack aren't in the bitmaps
+      if (!fromOutside.isEmpty() || (reverseCount && !excludedOutside.isEmpty()))
+         return false;
+
+      auto allTypes = bitmapIndex->typeBitmap(GitBitmapIndex::TypeBitmap::Commits);
+      allTypes |= bitmapIndex->typeBitmap(GitBitmapIndex::TypeBitmap::Trees);
+      allTypes |= bitmapIndex->typeBitmap(GitBitmapIndex::TypeBitmap::Blobs);
+      allTypes |= bitmapIndex->typeBitmap(GitBitmapIndex::TypeBitmap::Tags);
+
+      count = fromBitmap.countAndNot(excludedBitmap, allTypes);
+
+      if (reverseCount)
+         *reverseCount = excludedBitmap.countAndNot(fromBitmap, allTypes);
+
+      return true;
+   }
+
+   const auto &commits = bitmapIndex->typeBitmap(GitBitmapIndex::TypeBitmap::Commits);
+
+   count = fromBitmap.countAndNot(excludedBitmap, commits) + (fromOutside - excludedOutside).count();
+
+   if (reverseCount)
+      *reverseCount = excludedBitmap.countAndNot(fromBitmap, commits) + (excludedOutside - fromOutside).count();
+
+   return true;
+}
+
+bool GitAncestry::countByGit(const QString &from, const QStringList &excluded, bool withObjects, qint64 &count) const
+{
+   auto cmd = QString("git rev-list --count%1 %2").arg(withObjects ? QString(" --objects") : QString(), from);
+
+   for (const auto &name : excluded)
+      cmd.append(QString(" ^%1").arg(name));
+
+   const auto ret = mGitBase->run(cmd);
+   auto ok = false;
+
+   count = ret.success ? ret.output.trimmed().toLongLong(&ok) : 0;
+
+   return ok;
+}
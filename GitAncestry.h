@@ -0,0 +1,74 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <ObjectId.h>
+
+#include <QPair>
+#include <QSharedPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class GitBase;
+
+// Reachability queries between commits. They walk the commit-graph (using generation numbers to stop early) and the
+// object database, and only spawn git when some commit can't be read in-process or the walk gets too long. Answers
+// are remembered per repository, unless it's shallow or has grafts or replace refs.
+class GitAncestry
+{
+public:
+   explicit GitAncestry(const QSharedPointer<GitBase> &gitBase);
+
+   // Same semantics as merge-base --is-ancestor: a commit is an ancestor of itself. Branch names, tags and HEAD are
+   // accepted too.
+   bool isAncestor(const QString &ancestor, const QString &descendant) const;
+   // Both have to be commits. Answered without converting them to text unless git is needed.
+   bool isAncestor(const ObjectId &ancestor, const ObjectId &descendant) const;
+   // One answer per candidate, computed with a single walk from the descendant.
+   QVector<bool> areAncestors(const QStringList &candidates, const QString &descendant) const;
+   QVector<bool> isAncestorOf(const QString &ancestor, const QStringList &descendants) const;
+
+   // Same as rev-list --count from ^excluded... Answered with the reachability bitmaps when the repository has them.
+   bool countCommits(const QString &from, const QStringList &excluded, qint64 &count) const;
+   // Commits in local and not in upstream, and the other way around.
+   bool aheadBehind(const QString &local, const QString &upstream, qint64 &ahead, qint64 &behind) const;
+   // Ahead/behind of every tip against the same base with a single walk of the commit-graph. Tips must be full SHAs.
+   // False when the repository has no commit-graph or some commit can't be read.
+   bool aheadBehind(const QStringList &tips, const QString &base, QVector<QPair<qint64, qint64>> &counts) const;
+   // Same as countCommits but counting trees, blobs and tags too, like rev-list --objects.
+   bool countObjects(const QString &from, const QStringList &excluded, qint64 &count) const;
+
+private:
+   QSharedPointer<GitBase> mGitBase;
+
+   ObjectId resolveCommit(const QString &name) const;
+   QVector<bool> areAncestors(const QVector<ObjectId> &candidates, const ObjectId &descendant) const;
+   bool walk(const ObjectId &descendant, const QSet<ObjectId> &targets, QSet<ObjectId> &found) const;
+   bool isAncestorByGit(const ObjectId &ancestor, const ObjectId &descendant) const;
+   bool countByBitmap(const QString &from, const QStringList &excluded, bool withObjects, qint64 &count,
+                      qint64 *reverseCount = nullptr) const;
+   bool countByGit(const QString &from, const QStringList &excluded, bool withObjects, qint64 &count) const;
+};
@@ -1,15 +1,71 @@
 #include "GitBase.h"
 
 #include <GitAsyncProcess.h>
+#include <GitCommitGraph.h>
+#include <GitConfigDatabase.h>
+#include <GitNetworkProcess.h>
+#include <GitObjectDatabase.h>
+#include <GitRefDatabase.h>
+#include <GitRefSnapshot.h>
 #include <GitSyncProcess.h>
 
 #include <QLogger.h>
 
 using namespace QLogger;
 
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 
+#if defined(Q_OS_UNIX)
+#   include <sys/stat.h>
+#endif
+
+namespace
+{
+// Inode, size and modification time. Git writes HEAD to a lock file renamed over it, so any update gives a new inode.
+QByteArray statStamp(const QString &filePath)
+{
+   qint64 values[4] = { -1, -1, -1, -1 };
+
+#if defined(Q_OS_UNIX)
+   struct stat buffer;
+
+   if (::stat(QFile::encodeName(filePath).constData(), &buffer) == 0)
+   {
+      values[0] = static_cast<qint64>(buffer.st_ino);
+      values[1] = static_cast<qint64>(buffer.st_size);
+      values[2] = static_cast<qint64>(buffer.st_mtime);
+#   if defined(Q_OS_MACOS)
+      values[3] = static_cast<qint64>(buffer.st_mtimespec.tv_nsec);
+#   else
+      values[3] = static_cast<qint64>(buffer.st_mtim.tv_nsec);
+#   endif
+   }
+#else
+   if (const QFileInfo info(filePath); info.exists())
+   {
+      values[1] = info.size();
+      values[2] = info.lastModified().toMSecsSinceEpoch();
+   }
+#endif
+
+   return QByteArray(reinterpret_cast<const char *>(values), sizeof(values));
+}
+
+GitExecResult logResult(const QString &cmd, const GitExecResult &ret)
+{
+   const auto runOutput = ret.output;
+
+   if (ret.success && runOutput.contains("fatal:"))
+      QLog_Info("Git", QString("Git command {%1} reported issues:\n%2").arg(cmd, runOutput));
+   else if (!ret.success)
+      QLog_Warning("Git", QString("Git command {%1} has errors:\n%2").arg(cmd, runOutput));
+
+   return ret;
+}
+}
+
 GitBase::GitBase(const QString &workingDirectory)
    : mWorkingDirectory(workingDirectory)
    , mGitDirectory(mWorkingDirectory + "/.git")
@@ -44,6 +100,21 @@ QString GitBase::getGitDir() const
    return mGitDirectory;
 }
 
+QString GitBase::getGitCommonDir() const
+{
+   // Linked worktrees keep their own HEAD and index but share objects and refs with the main repository
+   QFile commonDir(QString("%1/commondir").arg(mGitDirectory));
+
+   if (commonDir.open(QIODevice::ReadOnly))
+   {
+      const auto path = QString::fromUtf8(commonDir.readAll()).trimmed();
+
+      return QDir::cleanPath(QDir::isAbsolutePath(path) ? path : QString("%1/%2").arg(mGitDirectory, path));
+   }
+
+   return mGitDirectory;
+}
+
 QString GitBase::getTopLevelRepo(const QString &path) const
 {
    QLog_Trace("Git", "Updating the cached current branch");
@@ -61,21 +132,46 @@ GitExecResult GitBase::run(const QString &cmd) const
 {
    GitSyncProcess p(mWorkingDirectory);
 
-   const auto ret = p.run(cmd);
-   const auto runOutput = ret.output;
+   return logResult(cmd, p.run(cmd));
+}
 
-   if (ret.success && runOutput.contains("fatal:"))
-      QLog_Info("Git", QString("Git command {%1} reported issues:\n%2").arg(cmd, runOutput));
-   else if (!ret.success)
-      QLog_Warning("Git", QString("Git command {%1} has errors:\n%2").arg(cmd, runOutput));
+GitExecResult GitBase::run(const QString &cmd, const QByteArray &input) const
+{
+   GitSyncProcess p(mWorkingDirectory);
 
-   return ret;
+   return logResult(cmd, p.run(cmd, input));
+}
+
+GitExecResult GitBase::runNetwork(const QString &cmd, const GitProgressCallback &onProgress) const
+{
+   GitNetworkProcess p(mWorkingDirectory);
+
+   if (onProgress)
+      QObject::connect(&p, &GitNetworkProcess::signalProgress, &p, onProgress, Qt::DirectConnection);
+
+   return logResult(cmd, p.run(cmd));
 }
 
 void GitBase::updateCurrentBranch()
 {
    QLog_Trace("Git", "Updating the cached current branch");
 
+   const auto refs = getRefDatabase();
+   mHeadInReftable = !refs->isSupported();
+
+   // Taken before reading, so a change made meanwhile is picked up by the next call
+   mHeadStamp = headStamp();
+
+   if (!mHeadInReftable)
+   {
+      // Same output as rev-parse --abbrev-ref HEAD: the branch name, HEAD when detached and nothing when unborn
+      const auto head = refs->resolve("HEAD");
+      const auto isBranch = head.symbolicTarget.startsWith("refs/heads/");
+
+      mCurrentBranch = !head.isValid() ? QString() : isBranch ? head.symbolicTarget.mid(11) : QString("HEAD");
+      return;
+   }
+
    const auto cmd = QString("git rev-parse --abbrev-ref HEAD");
 
    QLog_Trace("Git", QString("Updating the cached current branch: {%1}").arg(cmd));
@@ -87,7 +183,7 @@ void GitBase::updateCurrentBranch()
 
 QString GitBase::getCurrentBranch()
 {
-   if (mCurrentBranch.isEmpty())
+   if (mCurrentBranch.isEmpty() || headStamp() != mHeadStamp)
       updateCurrentBranch();
 
    return mCurrentBranch;
@@ -97,6 +193,12 @@ GitExecResult GitBase::getLastCommit() const
 {
    QLog_Trace("Git", "Getting last commit");
 
+   if (const auto refs = getRefDatabase(); refs->isSupported())
+   {
+      if (const auto head = refs->resolve("HEAD"); head.isValid())
+         return GitExecResult(true, head.sha);
+   }
+
    const auto cmd = QString("git rev-parse HEAD");
 
    QLog_Trace("Git", QString("Getting last commit: {%1}").arg(cmd));
@@ -105,3 +207,102 @@ GitExecResult GitBase::getLastCommit() const
 
    return ret;
 }
+
+ObjectId GitBase::getLastCommitId() const
+{
+   if (const auto refs = getRefDatabase(); refs->isSupported())
+   {
+      if (const auto head = refs->resolve("HEAD"); head.isValid())
+         return ObjectId::fromString(head.sha);
+   }
+
+   const auto ret = run("git rev-parse HEAD");
+
+   return ret.success ? ObjectId::fromString(ret.output.trimmed()) : ObjectId();
+}
+
+QByteArray GitBase::headStamp() const
+{
+   auto stamp = statStamp(QString("%1/HEAD").arg(mGitDirectory));
+
+   // With reftable HEAD is a placeholder, and the branch changes in the table list
+   if (mHeadInReftable)
+      stamp.append(statStamp(QString("%1/reftable/tables.list").arg(getGitCommonDir())));
+
+   return stamp;
+}
+
+QSharedPointer<GitCommitGraph> GitBase::getCommitGraph() const
+{
+   QMutexLocker lock(&mCacheMutex);
+
+   if (!mCommitGraph || mCommitGraph->isStale())
+   {
+      QLog_Trace("Git", "Loading the commit-graph");
+
+      auto commitGraph = QSharedPointer<GitCommitGraph>::create(QString("%1/objects").arg(getGitCommonDir()));
+      mCommitGraph = commitGraph->load() ? commitGraph : QSharedPointer<GitCommitGraph>();
+   }
+
+   return mCommitGraph;
+}
+
+QSharedPointer<GitObjectDatabase> GitBase::getObjectDatabase() const
+{
+   QMutexLocker lock(&mCacheMutex);
+
+   if (!mObjectDatabase)
+      mObjectDatabase = QSharedPointer<GitObjectDatabase>::create(QString("%1/objects").arg(getGitCommonDir()));
+
+   return mObjectDatabase;
+}
+
+QSharedPointer<GitConfigDatabase> GitBase::getConfigDatabase() const
+{
+   QMutexLocker lock(&mCacheMutex);
+
+   if (!mConfigDatabase)
+      mConfigDatabase = QSharedPointer<GitConfigDatabase>::create(mGitDirectory, getGitCommonDir());
+
+   return mConfigDatabase;
+}
+
+QSharedPointer<GitRefDatabase> GitBase::getRefDatabase() const
+{
+   QMutexLocker lock(&mCacheMutex);
+
+   if (!mRefDatabase)
+      mRefDatabase = QSharedPointer<GitRefDatabase>::create(mGitDirectory, getGitCommonDir());
+
+   return mRefDatabase;
+}
+
+QSharedPointer<const GitRefSnapshot> GitBase::getRefSnapshot() const
+{
+   const auto refs = getRefDatabase();
+   const auto config = getConfigDatabase()->snapshot();
+   // Reftable repositories can't be checked, so they are listed every time
+   const auto signature = refs->isSupported() ? refs->signature() : QByteArray();
+
+   {
+      QMutexLocker lock(&mCacheMutex);
+
+      if (mRefSnapshot && !signature.isEmpty() && mRefSnapshot->signature() == signature
+          && mRefSnapshot->config() == config)
+      {
+         return mRefSnapshot;
+      }
+   }
+
+   // Listed without the lock: it can take seconds in big repositories, and the other caches don't depend on it
+   auto snapshot = QSharedPointer<GitRefSnapshot>::create(signature, config);
+
+   if (!snapshot->load(*this))
+      return QSharedPointer<const GitRefSnapshot>();
+
+   QMutexLocker lock(&mCacheMutex);
+
+   mRefSnapshot = snapshot;
+
+   return snapshot;
+}
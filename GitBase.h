@@ -24,6 +24,17 @@
  ***************************************************************************************/
 
 #include <GitExecResult.h>
+#include <GitProgressParser.h>
+#include <ObjectId.h>
+
+#include <QMutex>
+#include <QSharedPointer>
+
+class GitCommitGraph;
+class GitConfigDatabase;
+class GitObjectDatabase;
+class GitRefDatabase;
+class GitRefSnapshot;
 
 class GitBase final
 {
@@ -31,6 +42,10 @@ public:
    explicit GitBase(const QString &workingDirectory);
 
    GitExecResult run(const QString &cmd) const;
+   GitExecResult run(const QString &cmd, const QByteArray &input) const;
+   // For the commands that can take long, as the ones that talk to a remote. They run while git keeps writing output,
+   // without a fixed timeout.
+   GitExecResult runNetwork(const QString &cmd, const GitProgressCallback &onProgress = {}) const;
 
    QString getWorkingDir() const;
 
@@ -38,16 +53,44 @@ public:
 
    QString getGitDir() const;
 
+   QString getGitCommonDir() const;
+
    QString getTopLevelRepo(const QString &path) const;
 
    void updateCurrentBranch();
 
+   // Re-reads HEAD only when a stat of it shows it was rewritten
    QString getCurrentBranch();
 
    GitExecResult getLastCommit() const;
+   // Null when HEAD doesn't point to a commit yet
+   ObjectId getLastCommitId() const;
+
+   QSharedPointer<GitCommitGraph> getCommitGraph() const;
+
+   QSharedPointer<GitObjectDatabase> getObjectDatabase() const;
+
+   QSharedPointer<GitConfigDatabase> getConfigDatabase() const;
+
+   QSharedPointer<GitRefDatabase> getRefDatabase() const;
+
+   // All the refs with their metadata. Listed again only when the refs or the config changed since the last call.
+   QSharedPointer<const GitRefSnapshot> getRefSnapshot() const;
 
 protected:
    QString mWorkingDirectory;
    QString mGitDirectory;
    QString mCurrentBranch;
+   QByteArray mHeadStamp;
+   bool mHeadInReftable = false;
+
+private:
+   mutable QMutex mCacheMutex;
+   mutable QSharedPointer<GitCommitGraph> mCommitGraph;
+   mutable QSharedPointer<GitObjectDatabase> mObjectDatabase;
+   mutable QSharedPointer<GitConfigDatabase> mConfigDatabase;
+   mutable QSharedPointer<GitRefDatabase> mRefDatabase;
+   mutable QSharedPointer<const GitRefSnapshot> mRefSnapshot;
+
+   QByteArray headStamp() const;
 };
@@ -0,0 +1,389 @@
+#include "GitBitmapIndex.h"
+
+#include <GitObjectDatabase.h>
+#include <GitPackFile.h>
+
+#include <QtAlgorithms>
+#include <QtEndian>
+
+#include <QLogger.h>
+
+#include <algorithm>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr quint32 BITMAP_SIGNATURE = 0x4249544d; // "BITM"
+
+// Decoded bitmaps of selected commits kept around, in bytes
+constexpr int DECODED_CACHE_SIZE = 64 * 1024 * 1024;
+
+quint32 readU32(const uchar *data)
+{
+   return qFromBigEndian<quint32>(data);
+}
+
+quint64 readU64(const uchar *data)
+{
+   return qFromBigEndian<quint64>(data);
+}
+}
+
+GitBitmapIndex::Bitmap::Bitmap(quint32 bitCount)
+   : mWords(static_cast<int>((static_cast<qint64>(bitCount) + 63) / 64), 0)
+{
+}
+
+bool GitBitmapIndex::Bitmap::test(quint32 bit) const
+{
+   const auto word = static_cast<int>(bit >> 6);
+
+   return word < mWords.size() && (mWords.at(word) >> (bit & 63)) & 1;
+}
+
+void GitBitmapIndex::Bitmap::set(quint32 bit)
+{
+   const auto word = static_cast<int>(bit >> 6);
+
+   if (word < mWords.size())
+      mWords[word] |= quint64(1) << (bit & 63);
+}
+
+GitBitmapIndex::Bitmap &GitBitmapIndex::Bitmap::operator|=(const Bitmap &other)
+{
+   const auto count = qMin(mWords.size(), other.mWords.size());
+   const auto words = mWords.data();
+   const auto otherWords = other.mWords.constData();
+
+   for (auto i = 0; i < count; ++i)
+      words[i] |= otherWords[i];
+
+   return *this;
+}
+
+GitBitmapIndex::Bitmap &GitBitmapIndex::Bitmap::operator^=(const Bitmap &other)
+{
+   const auto count = qMin(mWords.size(), other.mWords.size());
+   const auto words = mWords.data();
+   const auto otherWords = other.mWords.constData();
+
+   for (auto i = 0; i < count; ++i)
+      words[i] ^= otherWords[i];
+
+   return *this;
+}
+
+qint64 GitBitmapIndex::Bitmap::count() const
+{
+   qint64 total = 0;
+
+   for (const auto word : mWords)
+      total += qPopulationCount(word);
+
+   return total;
+}
+
+qint64 GitBitmapIndex::Bitmap::countAndNot(const Bitmap &excluded, const Bitmap &mask) const
+{
+   const auto count = qMin(mWords.size(), mask.mWords.size());
+   const auto excludedCount = excluded.mWords.size();
+   const auto words = mWords.constData();
+   const auto excludedWords = excluded.mWords.constData();
+   const auto maskWords = mask.mWords.constData();
+   qint64 total = 0;
+
+   // Compiled to hardware popcount where the target has it
+   for (auto i = 0; i < count; ++i)
+      total += qPopulationCount(words[i] & ~(i < excludedCount ? excludedWords[i] : 0) & maskWords[i]);
+
+   return total;
+}
+
+GitBitmapIndex::GitBitmapIndex(const QSharedPointer<GitPackFile> &pack)
+   : mPack(pack)
+   , mDecoded(DECODED_CACHE_SIZE)
+{
+}
+
+GitBitmapIndex::~GitBitmapIndex() = default;
+
+bool GitBitmapIndex::load()
+{
+   const auto indexPath = mPack->indexPath();
+   mFile.setFileName(indexPath.left(indexPath.length() - 4) + ".bitmap");
+
+   if (!mFile.open(QIODevice::ReadOnly))
+      return false;
+
+   const auto hashSize = mPack->hashSize();
+   mSize = mFile.size();
+   mData = mSize >= 12 + hashSize ? mFile.map(0, mSize) : nullptr;
+
+   if (!mData || readU32(mData) != BITMAP_SIGNATURE || qFromBigEndian<quint16>(mData + 4) != 1)
+   {
+      QLog_Warning("Git", QString("Unsupported bitmap file {%1}").arg(mFile.fileName()));
+      return false;
+   }
+
+   // A bitmap left behind by an older pack with the same name can't be used
+   if (QByteArray(reinterpret_cast<const char *>(mData + 12), hashSize) != mPack->checksum())
+      return false;
+
+   const auto entryCount = readU32(mData + 8);
+   qint64 pos = 12 + hashSize;
+
+   for (auto &typeBitmap : mTypeBitmaps)
+   {
+      if (!decode(pos, typeBitmap, &pos))
+         return false;
+   }
+
+   mEntries.reserve(static_cast<int>(entryCount));
+
+   for (auto i = 0u; i < entryCount; ++i)
+   {
+      if (pos + 6 + 8 > mSize)
+         return false;
+
+      Entry entry;
+      entry.indexPosition = readU32(mData + pos);
+      entry.xorOffset = mData[pos + 4];
+      entry.dataOffset = pos + 6;
+
+      if (entry.xorOffset > static_cast<int>(i) || entry.indexPosition >= mPack->objectCount())
+         return false;
+
+      pos = entry.dataOffset + 8 + static_cast<qint64>(readU32(mData + entry.dataOffset + 4)) * 8 + 4;
+
+      mEntryByPosition.insert(entry.indexPosition, mEntries.count());
+      mEntries.append(entry);
+   }
+
+   if (pos > mSize)
+      return false;
+
+   // Bits follow the pack order, while lookups give positions in the index
+   QVector<QPair<quint64, quint32>> offsets;
+   offsets.reserve(static_cast<int>(mPack->objectCount()));
+
+   for (auto i = 0u; i < mPack->objectCount(); ++i)
+      offsets.append(qMakePair(mPack->offsetAt(i), i));
+
+   std::sort(offsets.begin(), offsets.end());
+
+   mBitByIndexPosition.resize(offsets.count());
+
+   for (auto i = 0; i < offsets.count(); ++i)
+      mBitByIndexPosition[static_cast<int>(offsets.at(i).second)] = static_cast<quint32>(i);
+
+   QLog_Debug("Git", QString("Loaded {%1} reachability bitmaps from {%2}").arg(mEntries.count()).arg(mFile.fileName()));
+
+   return true;
+}
+
+quint32 GitBitmapIndex::bitCount() const
+{
+   return mPack->objectCount();
+}
+
+quint32 GitBitmapIndex::bitPosition(const ObjectId &id) const
+{
+   const auto position = mPack->findPosition(id);
+
+   return position == GitPackFile::NO_POSITION ? position : mBitByIndexPosition.at(static_cast<int>(position));
+}
+
+bool GitBitmapIndex::reachable(const QVector<ObjectId> &tips, const GitObjectDatabase &objects, bool withTrees,
+                               Bitmap &bitmap, QSet<ObjectId> &outsideCommits) const
+{
+   bitmap = Bitmap(bitCount());
+   outsideCommits.clear();
+
+   auto pending = tips;
+
+   while (!pending.isEmpty())
+   {
+      const auto id = pending.takeLast();
+      const auto position = mPack->findPosition(id);
+
+      if (position == GitPackFile::NO_POSITION)
+      {
+         if (outsideCommits.contains(id))
+            continue;
+
+         outsideCommits.insert(id);
+      }
+      else
+      {
+         const auto bit = mBitByIndexPosition.at(static_cast<int>(position));
+
+         if (bitmap.test(bit))
+            continue;
+
+         if (const auto entry = mEntryByPosition.constFind(position); entry != mEntryByPosition.cend())
+         {
+            Bitmap entryReach;
+
+            if (!entryBitmap(entry.value(), entryReach))
+               return false;
+
+            bitmap |= entryReach;
+            continue;
+         }
+
+         bitmap.set(bit);
+      }
+
+      const auto object = objects.read(id);
+
+      if (object.type != GitObjectDatabase::ObjectType::Commit)
+         return false;
+
+      const auto commit = GitObjectDatabase::parseCommit(object.data);
+
+      if (withTrees && !addTree(commit.tree, objects, bitmap))
+         return false;
+
+      pending.append(commit.parents);
+   }
+
+   return true;
+}
+
+bool GitBitmapIndex::decode(qint64 offset, Bitmap &bitmap, qint64 *end) const
+{
+   if (offset + 8 > mSize)
+      return false;
+
+   const auto wordCount = static_cast<qint64>(readU32(mData + offset + 4));
+   const auto words = mData + offset + 8;
+
+   if (offset + 8 + wordCount * 8 + 4 > mSize)
+      return false;
+
+   // EWAH: each marker word holds a run of identical words (0 or ~0) followed by a number of literal words
+   bitmap = Bitmap(bitCount());
+
+   auto &output = bitmap.words();
+   const auto outputSize = static_cast<qint64>(output.size());
+   qint64 outputPos = 0;
+
+   for (qint64 i = 0; i < wordCount;)
+   {
+      const auto marker = readU64(words + i * 8);
+      const auto runLength = static_cast<qint64>((marker >> 1) & 0xffffffff);
+      const auto literalCount = static_cast<qint64>(marker >> 33);
+
+      ++i;
+
+      if (i + literalCount > wordCount || outputPos + runLength + literalCount > outputSize)
+         return false;
+
+      if (marker & 1)
+         std::fill(output.begin() + outputPos, output.begin() + outputPos + runLength, ~quint64(0));
+
+      outputPos += runLength;
+
+      for (auto j = 0; j < literalCount; ++j)
+         output[static_cast<int>(outputPos++)] = readU64(words + (i + j) * 8);
+
+      i += literalCount;
+   }
+
+   if (end)
+      *end = offset + 8 + wordCount * 8 + 4;
+
+   return true;
+}
+
+bool GitBitmapIndex::entryBitmap(int entry, Bitmap &bitmap) const
+{
+   // Entries may be stored XORed with a previous one, which can be XORed in turn
+   QVector<int> chain { entry };
+   Bitmap base;
+   auto hasBase = false;
+
+   {
+      QMutexLocker lock(&mMutex);
+
+      while (true)
+      {
+         if (const auto cached = mDecoded.object(chain.constLast()))
+         {
+            base = *cached;
+            hasBase = true;
+            chain.removeLast();
+            break;
+         }
+
+         const auto xorOffset = mEntries.at(chain.constLast()).xorOffset;
+
+         if (xorOffset == 0)
+            break;
+
+         chain.append(chain.constLast() - xorOffset);
+      }
+   }
+
+   for (auto i = chain.count() - 1; i >= 0; --i)
+   {
+      Bitmap decoded;
+
+      if (!decode(mEntries.at(chain.at(i)).dataOffset, decoded))
+         return false;
+
+      if (hasBase)
+         decoded ^= base;
+
+      base = decoded;
+      hasBase = true;
+
+      QMutexLocker lock(&mMutex);
+      mDecoded.insert(chain.at(i), new Bitmap(base), static_cast<int>(base.words().size() * 8));
+   }
+
+   bitmap = base;
+
+   return true;
+}
+
+bool GitBitmapIndex::addTree(const ObjectId &tree, const GitObjectDatabase &objects, Bitmap &bitmap) const
+{
+   QVector<ObjectId> pending { tree };
+
+   while (!pending.isEmpty())
+   {
+      const auto treeId = pending.takeLast();
+      const auto bit = bitPosition(treeId);
+
+      // Everything below a tree already in the bitmap is in it too
+      if (bit != GitPackFile::NO_POSITION)
+      {
+         if (bitmap.test(bit))
+            continue;
+
+         bitmap.set(bit);
+      }
+
+      const auto object = objects.read(treeId);
+
+      if (object.type != GitObjectDatabase::ObjectType::Tree)
+         return false;
+
+      const auto entries = GitObjectDatabase::parseTree(object.data, mPack->hashSize());
+
+      for (const auto &entry : entries)
+      {
+         if (entry.isTree())
+            pending.append(entry.id);
+         else if (!entry.isSubmodule())
+         {
+            if (const auto blobBit = bitPosition(entry.id); blobBit != GitPackFile::NO_POSITION)
+               bitmap.set(blobBit);
+         }
+      }
+   }
+
+   return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <ObjectId.h>
+
+#include <QByteArray>
+#include <QCache>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+class GitObjectDatabase;
+class GitPackFile;
+
+// Reads the reachability bitmaps (.bitmap) written by repack --write-bitmap-index. Bit N stands for the N-th object
+// of the pack in offset order.
+class GitBitmapIndex
+{
+public:
+   class Bitmap
+   {
+   public:
+      Bitmap() = default;
+      explicit Bitmap(quint32 bitCount);
+
+      bool test(quint32 bit) const;
+      void set(quint32 bit);
+
+      Bitmap &operator|=(const Bitmap &other);
+      Bitmap &operator^=(const Bitmap &other);
+
+      qint64 count() const;
+      // Bits set here, not set in excluded, and set in mask
+      qint64 countAndNot(const Bitmap &excluded, const Bitmap &mask) const;
+
+      QVector<quint64> &words() { return mWords; }
+      const QVector<quint64> &words() const { return mWords; }
+
+   private:
+      QVector<quint64> mWords;
+   };
+
+   enum class TypeBitmap
+   {
+      Commits,
+      Trees,
+      Blobs,
+      Tags
+   };
+
+   explicit GitBitmapIndex(const QSharedPointer<GitPackFile> &pack);
+   ~GitBitmapIndex();
+
+   bool load();
+   QSharedPointer<GitPackFile> pack() const { return mPack; }
+   quint32 bitCount() const;
+   const Bitmap &typeBitmap(TypeBitmap type) const { return mTypeBitmaps[static_cast<int>(type)]; }
+
+   // The bit of an object, or GitPackFile::NO_POSITION when it's not in the pack.
+   quint32 bitPosition(const ObjectId &id) const;
+
+   // Everything reachable from the tips. Commits selected for a bitmap are taken as a whole; the others are walked
+   // reading their objects. Commits outside the pack (newer than the last repack) are returned in outsideCommits.
+   // With withTrees false, only the commits are collected. False if some object couldn't be read.
+   bool reachable(const QVector<ObjectId> &tips, const GitObjectDatabase &objects, bool withTrees, Bitmap &bitmap,
+                  QSet<ObjectId> &outsideCommits) const;
+
+private:
+   struct Entry
+   {
+      quint32 indexPosition = 0;
+      int xorOffset = 0;
+      qint64 dataOffset = 0;
+   };
+
+   QSharedPointer<GitPackFile> mPack;
+   QFile mFile;
+   const uchar *mData = nullptr;
+   qint64 mSize = 0;
+   Bitmap mTypeBitmaps[4];
+   QVector<Entry> mEntries;
+   QHash<quint32, int> mEntryByPosition;
+   QVector<quint32> mBitByIndexPosition;
+   mutable QMutex mMutex;
+   mutable QCache<int, Bitmap> mDecoded;
+
+   bool decode(qint64 offset, Bitmap &bitmap, qint64 *end = nullptr) const;
+   bool entryBitmap(int entry, Bitmap &bitmap) const;
+   bool addTree(const ObjectId &tree, const GitObjectDatabase &objects, Bitmap &bitmap) const;
+};
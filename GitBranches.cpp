@@ -1,15 +1,57 @@
 #include "GitBranches.h"
 
+#include <GitAncestry.h>
 #include <GitBase.h>
 #include <GitConfig.h>
+#include <GitConfigDatabase.h>
+#include <GitRefDatabase.h>
+#include <GitRefSnapshot.h>
+#include <GitRefTransaction.h>
 #include <GitRemote.h>
 
 #include <QLogger.h>
 
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
 #   include <QRegularExpression>
 
+#include <atomic>
+
 using namespace QLogger;
 
+namespace
+{
+// %(ahead-behind:) needs git 2.41. Once git says it doesn't know it there's no point in asking again.
+std::atomic<bool> aheadBehindAtomSupported { true };
+
+// Branches checked out in the main worktree or in a linked one, which git refuses to delete
+QStringList checkedOutBranches(const QString &commonDir)
+{
+   QStringList headPaths { QString("%1/HEAD").arg(commonDir) };
+   const auto worktrees = QDir(QString("%1/worktrees").arg(commonDir)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+   for (const auto &worktree : worktrees)
+      headPaths.append(QString("%1/worktrees/%2/HEAD").arg(commonDir, worktree));
+
+   QStringList branches;
+
+   for (const auto &headPath : std::as_const(headPaths))
+   {
+      QFile head(headPath);
+
+      if (head.open(QIODevice::ReadOnly))
+      {
+         if (const auto content = QString::fromUtf8(head.readLine().trimmed()); content.startsWith("ref: refs/heads/"))
+            branches.append(content.mid(16));
+      }
+   }
+
+   return branches;
+}
+}
+
 GitBranches::GitBranches(const QSharedPointer<GitBase> &gitBase)
    : mGitBase(gitBase)
 {
@@ -165,6 +207,70 @@ GitExecResult GitBranches::removeLocalBranch(const QString &branchName)
    return ret;
 }
 
+GitExecResult GitBranches::removeLocalBranches(const QStringList &branchNames)
+{
+   QLog_Debug("Git", QString("Removing {%1} local branches").arg(branchNames.count()));
+
+   const auto checkedOut = checkedOutBranches(mGitBase->getGitCommonDir());
+   const auto refs = mGitBase->getRefDatabase();
+   GitRefTransaction transaction(mGitBase);
+   QStringList sections;
+   QHash<QString, QString> reftableTips;
+
+   // Reftable can't be read here: one listing gives the tips of all the branches
+   if (!refs->isSupported())
+   {
+      const auto ret = mGitBase->run("git for-each-ref --format=%(refname)%20%(objectname) refs/heads");
+
+      if (!ret.success)
+         return ret;
+
+      const auto lines = ret.output.split('\n', Qt::SkipEmptyParts);
+
+      for (const auto &line : lines)
+         reftableTips.insert(line.section(' ', 0, 0), line.section(' ', 1, 1));
+   }
+
+   for (const auto &branch : branchNames)
+   {
+      if (checkedOut.contains(branch))
+         return GitExecResult(false, QString("The branch {%1} is checked out").arg(branch));
+
+      const auto refName = QString("refs/heads/%1").arg(branch);
+      QString sha;
+
+      if (refs->isSupported())
+      {
+         if (const auto ref = refs->resolve(refName); ref.isValid() && ref.name == refName)
+            sha = ref.sha;
+      }
+      else
+         sha = reftableTips.value(refName);
+
+      if (sha.isEmpty())
+         return GitExecResult(false, QString("The branch {%1} doesn't exist").arg(branch));
+
+      // Deleted only if it still points where it did when checked, so nothing moved meanwhile is lost
+      transaction.remove(refName, sha);
+      sections.append(QString("branch.%1").arg(branch));
+   }
+
+   const auto ret = transaction.commit();
+
+   if (!ret.success)
+      return ret;
+
+   if (QString error; !mGitBase->getConfigDatabase()->removeSections(GitConfigDatabase::Scope::Local, sections, &error))
+   {
+      QLog_Warning("Git", QString("Unable to remove the configuration of the deleted branches: %1").arg(error));
+
+      return GitExecResult(false,
+                           QString("The branches were removed but not their configuration: %1").arg(error));
+   }
+
+   return ret;
+}
+
 GitExecResult GitBranches::removeRemoteBranch(const QString &branchName)
 {
    auto branch = branchName;
@@ -189,6 +295,12 @@ GitExecResult GitBranches::getLastCommitOfBranch(const QString &branch)
 {
    QLog_Debug("Git", QString("Getting last commit of a branch: {%1}").arg(branch));
 
+   if (const auto refs = mGitBase->getRefDatabase(); refs->isSupported())
+   {
+      if (const auto ref = refs->resolveShortName(branch); ref.isValid())
+         return GitExecResult(true, ref.sha);
+   }
+
    const auto cmd = QString("git rev-parse %1").arg(branch);
 
    QLog_Trace("Git", QString("Getting last commit of a branch: {%1}").arg(cmd));
@@ -201,16 +313,17 @@ GitExecResult GitBranches::getLastCommitOfBranch(const QString &branch)
    return ret;
 }
 
-GitExecResult GitBranches::pushUpstream(const QString &remoteBranch, const QString &remote, const QString &localBranch)
+GitExecResult GitBranches::pushUpstream(const QString &remoteBranch, const QString &remote, const QString &localBranch,
+                                        const GitProgressCallback &onProgress)
 {
    QLog_Debug("Git", QString("Pushing upstream: {%1/%2}").arg(remote, remoteBranch));
 
-   const auto cmd
-       = QString("git push --set-upstream %1 %2").arg(remote, QString("%1:%2").arg(localBranch, remoteBranch));
+   const auto cmd = QString("git push --progress --set-upstream %1 %2")
+                        .arg(remote, QString("%1:%2").arg(localBranch, remoteBranch));
 
    QLog_Trace("Git", QString("Pushing upstream: {%1}").arg(cmd));
 
-   const auto ret = mGitBase->run(cmd);
+   const auto ret = mGitBase->runNetwork(cmd, onProgress);
 
    return ret;
 }
@@ -265,16 +378,237 @@ bool GitBranches::isCommitInCurrentGeneologyTree(const QString &sha) const
 {
    QLog_Debug("Git", QString("Check if commit {%1} is in current geneology tree").arg(sha));
 
-   const auto cmd = QString("git branch --contains %1").arg(sha);
+   return GitAncestry(mGitBase).isAncestor(sha, "HEAD");
+}
+
+bool GitBranches::isCommitInCurrentGeneologyTree(const ObjectId &id) const
+{
+   QLog_Debug("Git", QString("Check if commit {%1} is in current geneology tree").arg(id.toString()));
+
+   const auto head = mGitBase->getLastCommitId();
+
+   return !head.isNull() && GitAncestry(mGitBase).isAncestor(id, head);
+}
+
+QVector<GitBranches::AheadBehind> GitBranches::getAheadBehind(const QString &base) const
+{
+   QLog_Debug("Git", QString("Getting ahead/behind of the local branches against {%1}")
+                         .arg(base.isEmpty() ? QString("their upstreams") : base));
+
+   return base.isEmpty() ? aheadBehindUpstreams() : aheadBehindBase(base);
+}
+
+QVector<GitBranches::AheadBehind> GitBranches::aheadBehindUpstreams() const
+{
+   const auto cmd
+       = QString("git for-each-ref --format=%(refname)%09%(upstream:short)%09%(upstream:track,nobracket) refs/heads");
+
+   QLog_Trace("Git", QString("Getting ahead/behind against the upstreams: {%1}").arg(cmd));
+
    const auto ret = mGitBase->run(cmd);
+   QVector<AheadBehind> table;
 
-   if (ret.success)
+   if (!ret.success)
+      return table;
+
+   const auto lines = ret.output.split('\n', Qt::SkipEmptyParts);
+
+   for (const auto &line : lines)
+   {
+      const auto fields = line.split('\t');
+
+      if (fields.count() < 3 || fields.at(1).isEmpty() || fields.at(2) == QString("gone"))
+         continue;
+
+      AheadBehind row;
+      row.branch = fields.at(0).mid(11);
+      row.upstream = fields.at(1);
+
+      // "ahead 2, behind 3", only one of them or nothing when in sync
+      const auto counts = fields.at(2).split(", ", Qt::SkipEmptyParts);
+
+      for (const auto &count : counts)
+      {
+         if (count.startsWith("ahead "))
+            row.ahead = count.mid(6).toInt();
+         else if (count.startsWith("behind "))
+            row.behind = count.mid(7).toInt();
+      }
+
+      table.append(row);
+   }
+
+   return table;
+}
+
+QVector<GitBranches::AheadBehind> GitBranches::aheadBehindBase(const QString &base) const
+{
+   QVector<AheadBehind> table;
+
+   if (aheadBehindAtomSupported)
    {
-      const auto branches = ret.output.trimmed();
+      // Not built with arg(): %09 would be taken as a placeholder
+      const auto cmd = QString("git for-each-ref --format=%(refname)%09%(ahead-behind:") + base + ") refs/heads";
+
+      QLog_Trace("Git", QString("Getting ahead/behind against a base: {%1}").arg(cmd));
+
+      if (const auto ret = mGitBase->run(cmd); ret.success)
+      {
+         const auto lines = ret.output.split('\n', Qt::SkipEmptyParts);
+
+         for (const auto &line : lines)
+         {
+            const auto fields = line.split('\t');
+            const auto counts = fields.value(1).split(' ');
+
+            AheadBehind row;
+            row.branch = fields.at(0).mid(11);
+            row.upstream = base;
+            row.ahead = counts.value(0).toInt();
+            row.behind = counts.value(1).toInt();
+
+            table.append(row);
+         }
+
+         return table;
+      }
+      else if (!ret.output.contains("unknown field name", Qt::CaseInsensitive))
+      {
+         QLog_Warning("Git", QString("Unable to get ahead/behind against {%1}: %2").arg(base, ret.output));
+         return table;
+      }
+
+      // Only git older than 2.41 doesn't know the atom
+      aheadBehindAtomSupported = false;
+   }
+
+   // Older git: one walk for all the branches in-process, or one rev-list per branch as last resort
+   const auto ret = mGitBase->run(QString("git for-each-ref --format=%(refname)%09%(objectname) refs/heads"));
+
+   if (!ret.success)
+      return table;
+
+   QStringList branches;
+   QStringList shas;
+   const auto lines = ret.output.split('\n', Qt::SkipEmptyParts);
 
-      if (branches.contains(mGitBase->getCurrentBranch()))
-         return ret.success;
+   for (const auto &line : lines)
+   {
+      const auto fields = line.split('\t');
+      branches.append(fields.at(0).mid(11));
+      shas.append(fields.value(1));
    }
 
-   return false;
+   const GitAncestry ancestry(mGitBase);
+   QVector<QPair<qint64, qint64>> counts;
+
+   if (!ancestry.aheadBehind(shas, base, counts))
+   {
+      counts.clear();
+
+      for (const auto &sha : std::as_const(shas))
+      {
+         qint64 ahead = 0;
+         qint64 behind = 0;
+
+         if (!ancestry.aheadBehind(sha, base, ahead, behind))
+         {
+            QLog_Warning("Git", QString("Unable to get ahead/behind of {%1} against {%2}").arg(sha, base));
+            ahead = -1;
+            behind = -1;
+         }
+
+         counts.append(qMakePair(ahead, behind));
+      }
+   }
+
+   for (auto i = 0; i < branches.count(); ++i)
+   {
+      AheadBehind row;
+      row.branch = branches.at(i);
+      row.upstream = base;
+      row.ahead = static_cast<int>(counts.at(i).first);
+      row.behind = static_cast<int>(counts.at(i).second);
+
+      table.append(row);
+   }
+
+   return table;
+}
+
+GitExecResult GitBranches::analyzeBranches(const QString &target, int staleDays, BranchAnalysis &analysis) const
+{
+   QLog_Debug("Git", QString("Classifying the branches against {%1}").arg(target));
+
+   analysis = BranchAnalysis();
+
+   const auto snapshot = mGitBase->getRefSnapshot();
+
+   if (!snapshot)
+      return GitExecResult(false, QString("Unable to list the branches"));
+
+   // The target itself isn't reported, under whichever name it was given
+   auto targetRef = -1;
+
+   for (const auto &prefix : { "", "refs/heads/", "refs/remotes/" })
+   {
+      if (targetRef = snapshot->indexOf(QString::fromUtf8(prefix) + target); targetRef >= 0)
+         break;
+   }
+
+   QStringList names;
+   QStringList tips;
+   QVector<qint64> dates;
+   const auto &refs = snapshot->refs();
+
+   for (auto i = 0; i < refs.count(); ++i)
+   {
+      const auto name = snapshot->string(refs.at(i).name);
+      const auto isLocal = name.startsWith("refs/heads/");
+
+      if (i == targetRef || (!isLocal && !name.startsWith("refs/remotes/")) || name.endsWith("/HEAD"))
+         continue;
+
+      names.append(name.mid(isLocal ? 11 : 13));
+      tips.append(refs.at(i).target.toString());
+      dates.append(refs.at(i).date);
+   }
+
+   QString targetSha;
+
+   if (targetRef >= 0)
+   {
+      const auto &ref = refs.at(targetRef);
+      targetSha = (ref.peeled.isNull() ? ref.target : ref.peeled).toString();
+   }
+
+   // Without a valid target nothing would be merged, and every branch would look stale or diverged
+   if (targetSha.isEmpty())
+   {
+      const auto ret = mGitBase->run(QString("git rev-parse --verify -q %1^{commit}").arg(target));
+
+      if (!ret.success || ret.output.trimmed().isEmpty())
+         return GitExecResult(false, QString("The target {%1} isn't a commit").arg(target));
+
+      targetSha = ret.output.trimmed();
+   }
+   const auto merged = GitAncestry(mGitBase).areAncestors(tips, targetSha);
+   const auto staleBefore = QDateTime::currentSecsSinceEpoch() - static_cast<qint64>(staleDays) * 24 * 60 * 60;
+
+   for (auto i = 0; i < names.count(); ++i)
+   {
+      if (merged.at(i))
+         analysis.merged.append(names.at(i));
+      else if (dates.at(i) < staleBefore)
+         analysis.stale.append(names.at(i));
+      else
+         analysis.diverged.append(names.at(i));
+   }
+
+   QLog_Debug("Git", QString("{%1} merged, {%2} stale and {%3} diverged branches")
+                         .arg(analysis.merged.count())
+                         .arg(analysis.stale.count())
+                         .arg(analysis.diverged.count()));
+
+   return GitExecResult(true, QString());
 }
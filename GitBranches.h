@@ -24,14 +24,38 @@
  ***************************************************************************************/
 
 #include <GitExecResult.h>
+#include <GitProgressParser.h>
+#include <ObjectId.h>
 
 #include <QSharedPointer>
+#include <QVector>
 
 class GitBase;
 
 class GitBranches
 {
 public:
+   struct AheadBehind
+   {
+      QString branch;
+      // The upstream, or the base when one was given
+      QString upstream;
+      // Both -1 when they couldn't be computed
+      int ahead = 0;
+      int behind = 0;
+   };
+
+   // Local and remote branches by short name (master, origin/feature). Each branch is in one list only.
+   struct BranchAnalysis
+   {
+      // The tip is reachable from the target
+      QStringList merged;
+      // Not merged, with no commit newer than the given age
+      QStringList stale;
+      // Not merged and still active
+      QStringList diverged;
+   };
+
    GitBranches(const QSharedPointer<GitBase> &gitBase);
    GitExecResult createBranchFromAnotherBranch(const QString &oldName, const QString &newName);
    GitExecResult checkoutNewLocalBranchFromAnotherBranch(const QString &oldName, const QString &newName) const;
@@ -42,15 +66,28 @@ public:
    GitExecResult checkoutNewLocalBranch(const QString &branchName);
    GitExecResult renameBranch(const QString &oldName, const QString &newName);
    GitExecResult removeLocalBranch(const QString &branchName);
+   // Deletes all the branches in one ref transaction, or none of them, and drops their config sections
+   GitExecResult removeLocalBranches(const QStringList &branchNames);
    GitExecResult removeRemoteBranch(const QString &branchName);
    GitExecResult getLastCommitOfBranch(const QString &branch);
-   GitExecResult pushUpstream(const QString &localBranch, const QString &remote, const QString &remoteBranch);
+   GitExecResult pushUpstream(const QString &localBranch, const QString &remote, const QString &remoteBranch,
+                              const GitProgressCallback &onProgress = {});
    GitExecResult rebaseOnto(const QString &currentBranch, const QString &startBranch, const QString &fromBranch) const;
    GitExecResult unsetUpstream() const;
    GitExecResult resetToOrigin(const QString &branch) const;
    GitExecResult resetToSha(const QString &branch, const QString &sha) const;
    bool isCommitInCurrentGeneologyTree(const QString &sha) const;
+   bool isCommitInCurrentGeneologyTree(const ObjectId &id) const;
+   // Every local branch against its upstream (branches without one or with a deleted one are left out), or against
+   // base when given. A single git call for all branches.
+   QVector<AheadBehind> getAheadBehind(const QString &base = QString()) const;
+   // Classifies every branch with a single walk from the target and the tip dates of the ref snapshot. Fails, with the
+   // reason as output, when the refs can't be listed or the target doesn't name a commit.
+   GitExecResult analyzeBranches(const QString &target, int staleDays, BranchAnalysis &analysis) const;
 
 private:
    QSharedPointer<GitBase> mGitBase;
+
+   QVector<AheadBehind> aheadBehindUpstreams() const;
+   QVector<AheadBehind> aheadBehindBase(const QString &base) const;
 };
@@ -3,6 +3,8 @@
 GitCloneProcess::GitCloneProcess(const QString &workingDir)
    : AGitProcess(workingDir)
 {
+   qRegisterMetaType<GitProgress>("GitProgress");
+
    connect(this, &AGitProcess::readyReadStandardError, this, &GitCloneProcess::onReadyStandardError,
            Qt::DirectConnection);
 }
@@ -16,25 +18,30 @@ void GitCloneProcess::onReadyStandardError()
 {
    if (!mCanceling)
    {
-      const auto err = readAllStandardError();
-      const auto errStr = QString::fromUtf8(err);
-      mErrorOutput += errStr;
+      const auto updates = mParser.feed(readAllStandardError());
+      const auto lines = mParser.lines();
 
-      if (errStr.contains("fatal:"))
+      for (; mReportedLines < lines.count(); ++mReportedLines)
       {
-          mCanceling = true;
-          emit signalCloningFailure(-1, errStr);
+         const auto &line = lines.at(mReportedLines);
+
+         if (line.contains("fatal:"))
+         {
+            mCanceling = true;
+            emit signalCloningFailure(-1, line);
+            return;
+         }
+
+         if (!line.startsWith("remote: "))
+            emit signalProgress(line, -1);
       }
-      else if (!errStr.startsWith("remote: "))
-      {
-         auto infoList = errStr.split(",", Qt::SkipEmptyParts).first().split(":");
-         const auto stepDesc = infoList.takeFirst();
-         auto value = -1;
 
-         if (!infoList.isEmpty())
-            value = infoList.takeFirst().split("% ").first().trimmed().toInt();
+      for (const auto &progress : updates)
+      {
+         if (!progress.remote)
+            emit signalProgress(progress.description, progress.percent);
 
-         emit signalProgress(stepDesc, value);
+         emit signalTransferProgress(progress);
       }
    }
 }
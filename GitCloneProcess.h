@@ -24,6 +24,7 @@
  ***************************************************************************************/
 
 #include <AGitProcess.h>
+#include <GitProgressParser.h>
 
 class GitCloneProcess final : public AGitProcess
 {
@@ -31,6 +32,8 @@ class GitCloneProcess final : public AGitProcess
 
 signals:
    void signalProgress(QString stepDescription, int value);
+   // Same updates with the counts, the bytes received and the throughput
+   void signalTransferProgress(GitProgress progress);
    void signalCloningFailure(int error, QString description);
 
 public:
@@ -39,6 +42,9 @@ public:
    GitExecResult run(const QString &command) override;
 
 private:
+   GitProgressParser mParser;
+   int mReportedLines = 0;
+
    void onReadyStandardError();
    void onFinished(int, QProcess::ExitStatus exitStatus) override;
 };
@@ -0,0 +1,528 @@
+#include "GitCommitGraph.h"
+
+#include <FileStamp.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <QLogger.h>
+
+#include <cstring>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr quint32 GRAPH_SIGNATURE = 0x43475048; // "CGPH"
+constexpr quint32 CHUNK_OID_FANOUT = 0x4f494446; // "OIDF"
+constexpr quint32 CHUNK_OID_LOOKUP = 0x4f49444c; // "OIDL"
+constexpr quint32 CHUNK_COMMIT_DATA = 0x43444154; // "CDAT"
+constexpr quint32 CHUNK_GENERATION_DATA = 0x47444132; // "GDA2"
+constexpr quint32 CHUNK_GENERATION_OVERFLOW = 0x47444f32; // "GDO2"
+constexpr quint32 CHUNK_EXTRA_EDGES = 0x45444745; // "EDGE"
+constexpr quint32 CHUNK_BLOOM_INDEXES = 0x42494458; // "BIDX"
+constexpr quint32 CHUNK_BLOOM_DATA = 0x42444154; // "BDAT"
+
+constexpr quint32 PARENT_NONE = 0x70000000;
+constexpr quint32 EXTRA_EDGES_NEEDED = 0x80000000;
+constexpr quint32 LAST_EDGE = 0x80000000;
+constexpr quint32 GENERATION_OVERFLOW = 0x80000000;
+
+constexpr quint32 BLOOM_SEED_0 = 0x293ae76f;
+constexpr quint32 BLOOM_SEED_1 = 0x7e646e2c;
+
+quint32 readU32(const uchar *data)
+{
+   return qFromBigEndian<quint32>(data);
+}
+
+quint64 readU64(const uchar *data)
+{
+   return qFromBigEndian<quint64>(data);
+}
+
+quint32 rotateLeft(quint32 value, int count)
+{
+   return (value << count) | (value >> (32 - count));
+}
+
+// Version 1 of the changed-path filters hashed the bytes as signed chars. Git keeps reading those filters, so we have
+// to reproduce the same values to query them.
+template<bool SignedBytes>
+quint32 byteAt(const char *data, int index)
+{
+   if (SignedBytes)
+      return static_cast<quint32>(static_cast<qint32>(static_cast<qint8>(data[index])));
+
+   return static_cast<quint32>(static_cast<uchar>(data[index]));
+}
+
+template<bool SignedBytes>
+quint32 murmur3(quint32 seed, const char *data, int len)
+{
+   constexpr quint32 c1 = 0xcc9e2d51;
+   constexpr quint32 c2 = 0x1b873593;
+
+   const auto blocks = len / 4;
+
+   for (auto i = 0; i < blocks; ++i)
+   {
+      auto k = byteAt<SignedBytes>(data, 4 * i) | (byteAt<SignedBytes>(data, 4 * i + 1) << 8)
+          | (byteAt<SignedBytes>(data, 4 * i + 2) << 16) | (byteAt<SignedBytes>(data, 4 * i + 3) << 24);
+
+      k *= c1;
+      k = rotateLeft(k, 15);
+      k *= c2;
+
+      seed ^= k;
+      seed = rotateLeft(seed, 13) * 5 + 0xe6546b64;
+   }
+
+   const auto tail = data + blocks * 4;
+   quint32 k1 = 0;
+
+   switch (len & 3)
+   {
+      case 3:
+         k1 ^= byteAt<SignedBytes>(tail, 2) << 16;
+         [[fallthrough]];
+      case 2:
+         k1 ^= byteAt<SignedBytes>(tail, 1) << 8;
+         [[fallthrough]];
+      case 1:
+         k1 ^= byteAt<SignedBytes>(tail, 0);
+         k1 *= c1;
+         k1 = rotateLeft(k1, 15);
+         k1 *= c2;
+         seed ^= k1;
+         break;
+   }
+
+   seed ^= static_cast<quint32>(len);
+   seed ^= seed >> 16;
+   seed *= 0x85ebca6b;
+   seed ^= seed >> 13;
+   seed *= 0xc2b2ae35;
+   seed ^= seed >> 16;
+
+   return seed;
+}
+}
+
+struct GitCommitGraph::Layer
+{
+   QFile file;
+   const uchar *data = nullptr;
+   quint32 commitCount = 0;
+   quint32 commitsInBase = 0;
+   const uchar *fanout = nullptr;
+   const uchar *oidLookup = nullptr;
+   const uchar *commitData = nullptr;
+   const uchar *generationData = nullptr;
+   quint64 generationDataSize = 0;
+   const uchar *generationOverflow = nullptr;
+   quint64 generationOverflowCount = 0;
+   const uchar *extraEdges = nullptr;
+   quint64 extraEdgesCount = 0;
+   const uchar *bloomIndexes = nullptr;
+   const uchar *bloomData = nullptr;
+   quint64 bloomDataSize = 0;
+   quint32 bloomHashVersion = 0;
+   quint32 bloomHashCount = 0;
+};
+
+GitCommitGraph::GitCommitGraph(const QString &objectsDir)
+   : mObjectsDir(objectsDir)
+{
+}
+
+GitCommitGraph::~GitCommitGraph() = default;
+
+bool GitCommitGraph::load()
+{
+   mLayers.clear();
+   mCommitCount = 0;
+   mHasBloomFilters = false;
+   mHasCorrectedDates = true;
+
+   const auto singleFile = QString("%1/info/commit-graph").arg(mObjectsDir);
+   const auto chainFile = QString("%1/info/commit-graphs/commit-graph-chain").arg(mObjectsDir);
+
+   mFileStamps = { fileStamp(singleFile), fileStamp(chainFile) };
+
+   auto loaded = false;
+
+   if (QFileInfo::exists(singleFile))
+      loaded = loadLayer(singleFile, 0);
+   else if (QFile chain(chainFile); chain.open(QIODevice::ReadOnly))
+   {
+      const auto hashes = QString::fromUtf8(chain.readAll()).split('\n', Qt::SkipEmptyParts);
+
+      loaded = !hashes.isEmpty();
+
+      for (const auto &hash : hashes)
+      {
+         const auto layerFile = QString("%1/info/commit-graphs/graph-%2.graph").arg(mObjectsDir, hash.trimmed());
+
+         if (!loadLayer(layerFile, mCommitCount))
+         {
+            loaded = false;
+            break;
+         }
+      }
+   }
+
+   if (!loaded)
+   {
+      mLayers.clear();
+      mCommitCount = 0;
+      mHasBloomFilters = false;
+      mHasCorrectedDates = false;
+   }
+
+   QLog_Debug("Git",
+              QString("Commit-graph loaded with {%1} commits in {%2} layers").arg(mCommitCount).arg(mLayers.count()));
+
+   return isValid();
+}
+
+bool GitCommitGraph::isStale() const
+{
+   const auto singleFile = QString("%1/info/commit-graph").arg(mObjectsDir);
+   const auto chainFile = QString("%1/info/commit-graphs/commit-graph-chain").arg(mObjectsDir);
+
+   return mFileStamps != QVector<qint64> { fileStamp(singleFile), fileStamp(chainFile) };
+}
+
+bool GitCommitGraph::loadLayer(const QString &filePath, quint32 commitsInBase)
+{
+   auto layer = QSharedPointer<Layer>::create();
+   layer->file.setFileName(filePath);
+
+   if (!layer->file.open(QIODevice::ReadOnly))
+      return false;
+
+   const auto size = layer->file.size();
+
+   if (size < 8 + 12)
+      return false;
+
+   layer->data = layer->file.map(0, size);
+
+   if (!layer->data)
+      return false;
+
+   const auto data = layer->data;
+
+   if (readU32(data) != GRAPH_SIGNATURE || data[4] != 1)
+   {
+      QLog_Warning("Git", QString("Unsupported commit-graph file {%1}").arg(filePath));
+      return false;
+   }
+
+   const auto hashSize = data[5] == 2 ? 32 : 20;
+   const auto chunkCount = static_cast<int>(data[6]);
+
+   if (!mLayers.isEmpty() && hashSize != mHashSize)
+      return false;
+
+   mHashSize = hashSize;
+
+   if (8 + (chunkCount + 1) * 12 > size)
+      return false;
+
+   for (auto i = 0; i < chunkCount; ++i)
+   {
+      const auto entry = data + 8 + i * 12;
+      const auto id = readU32(entry);
+      const auto offset = readU64(entry + 4);
+      const auto nextOffset = readU64(entry + 16);
+
+      if (offset > nextOffset || nextOffset > static_cast<quint64>(size))
+         return false;
+
+      const auto chunk = data + offset;
+      const auto chunkSize = nextOffset - offset;
+
+      switch (id)
+      {
+         case CHUNK_OID_FANOUT:
+            layer->fanout = chunkSize >= 256 * 4 ? chunk : nullptr;
+            break;
+         case CHUNK_OID_LOOKUP:
+            layer->oidLookup = chunk;
+            break;
+         case CHUNK_COMMIT_DATA:
+            layer->commitData = chunk;
+            break;
+         case CHUNK_GENERATION_DATA:
+            layer->generationData = chunk;
+            layer->generationDataSize = chunkSize;
+            break;
+         case CHUNK_GENERATION_OVERFLOW:
+            layer->generationOverflow = chunk;
+            layer->generationOverflowCount = chunkSize / 8;
+            break;
+         case CHUNK_EXTRA_EDGES:
+            layer->extraEdges = chunk;
+            layer->extraEdgesCount = chunkSize / 4;
+            break;
+         case CHUNK_BLOOM_INDEXES:
+            layer->bloomIndexes = chunk;
+            break;
+         case CHUNK_BLOOM_DATA:
+            if (chunkSize >= 12)
+            {
+               layer->bloomHashVersion = readU32(chunk);
+               layer->bloomHashCount = readU32(chunk + 4);
+               layer->bloomData = chunk + 12;
+               layer->bloomDataSize = chunkSize - 12;
+            }
+            break;
+         default:
+            break;
+      }
+   }
+
+   if (!layer->fanout || !layer->oidLookup || !layer->commitData)
+      return false;
+
+   layer->commitCount = readU32(layer->fanout + 255 * 4);
+   layer->commitsInBase = commitsInBase;
+
+   const auto commitDataEnd = layer->commitData + static_cast<quint64>(layer->commitCount) * (mHashSize + 16);
+   const auto oidLookupEnd = layer->oidLookup + static_cast<quint64>(layer->commitCount) * mHashSize;
+
+   if (commitDataEnd > data + size || oidLookupEnd > data + size)
+      return false;
+
+   if (layer->bloomHashVersion != 1 && layer->bloomHashVersion != 2)
+   {
+      layer->bloomIndexes = nullptr;
+      layer->bloomData = nullptr;
+   }
+
+   if (layer->bloomIndexes && layer->bloomIndexes + layer->commitCount * 4 > data + size)
+      layer->bloomIndexes = nullptr;
+
+   // Without a full table the topological levels are used instead, as git does with a damaged chunk
+   if (layer->generationData && layer->generationDataSize < static_cast<quint64>(layer->commitCount) * 4)
+      layer->generationData = nullptr;
+
+   mHasBloomFilters |= layer->bloomIndexes && layer->bloomData;
+   mHasCorrectedDates &= layer->generationData != nullptr;
+   mCommitCount += layer->commitCount;
+   mLayers.append(layer);
+
+   return true;
+}
+
+const GitCommitGraph::Layer *GitCommitGraph::layerFor(quint32 &pos) const
+{
+   for (const auto &layer : mLayers)
+   {
+      if (pos >= layer->commitsInBase && pos - layer->commitsInBase < layer->commitCount)
+      {
+         pos -= layer->commitsInBase;
+         return layer.data();
+      }
+   }
+
+   return nullptr;
+}
+
+quint32 GitCommitGraph::findCommit(const ObjectId &id) const
+{
+   if (id.size() != mHashSize)
+      return NO_POSITION;
+
+   const auto firstByte = id.data()[0];
+
+   for (const auto &layer : mLayers)
+   {
+      auto low = firstByte == 0 ? 0u : readU32(layer->fanout + (firstByte - 1) * 4);
+      auto high = readU32(layer->fanout + firstByte * 4);
+
+      while (low < high)
+      {
+         const auto mid = low + (high - low) / 2;
+         const auto cmp = memcmp(layer->oidLookup + static_cast<quint64>(mid) * mHashSize, id.data(), mHashSize);
+
+         if (cmp == 0)
+            return layer->commitsInBase + mid;
+         else if (cmp < 0)
+            low = mid + 1;
+         else
+            high = mid;
+      }
+   }
+
+   return NO_POSITION;
+}
+
+quint32 GitCommitGraph::findCommit(const QByteArray &rawOid) const
+{
+   return findCommit(ObjectId::fromRaw(rawOid));
+}
+
+quint32 GitCommitGraph::findCommit(const QString &sha) const
+{
+   return findCommit(ObjectId::fromString(sha));
+}
+
+QByteArray GitCommitGraph::commitId(quint32 pos) const
+{
+   const auto layer = layerFor(pos);
+
+   if (!layer)
+      return QByteArray();
+
+   return QByteArray(reinterpret_cast<const char *>(layer->oidLookup + static_cast<quint64>(pos) * mHashSize),
+                     mHashSize);
+}
+
+QString GitCommitGraph::commitSha(quint32 pos) const
+{
+   return QString::fromLatin1(commitId(pos).toHex());
+}
+
+QByteArray GitCommitGraph::rootTree(quint32 pos) const
+{
+   const auto layer = layerFor(pos);
+
+   if (!layer)
+      return QByteArray();
+
+   const auto entry = layer->commitData + static_cast<quint64>(pos) * (mHashSize + 16);
+
+   return QByteArray(reinterpret_cast<const char *>(entry), mHashSize);
+}
+
+QVector<quint32> GitCommitGraph::parents(quint32 pos) const
+{
+   QVector<quint32> parents;
+   const auto layer = layerFor(pos);
+
+   if (!layer)
+      return parents;
+
+   const auto entry = layer->commitData + static_cast<quint64>(pos) * (mHashSize + 16) + mHashSize;
+   const auto firstParent = readU32(entry);
+   const auto secondParent = readU32(entry + 4);
+
+   if (firstParent == PARENT_NONE)
+      return parents;
+
+   parents.append(firstParent);
+
+   if (secondParent == PARENT_NONE)
+      return parents;
+
+   if (!(secondParent & EXTRA_EDGES_NEEDED))
+   {
+      parents.append(secondParent);
+      return parents;
+   }
+
+   // Octopus merges store the second and following parents in the extra edges list
+   for (quint64 edge = secondParent & ~EXTRA_EDGES_NEEDED; edge < layer->extraEdgesCount; ++edge)
+   {
+      const auto value = readU32(layer->extraEdges + edge * 4);
+      parents.append(value & ~LAST_EDGE);
+
+      if (value & LAST_EDGE)
+         break;
+   }
+
+   return parents;
+}
+
+quint32 GitCommitGraph::topologicalLevel(quint32 pos) const
+{
+   const auto layer = layerFor(pos);
+
+   if (!layer)
+      return 0;
+
+   const auto entry = layer->commitData + static_cast<quint64>(pos) * (mHashSize + 16) + mHashSize + 8;
+
+   return readU32(entry) >> 2;
+}
+
+qint64 GitCommitGraph::commitDate(quint32 pos) const
+{
+   const auto layer = layerFor(pos);
+
+   if (!layer)
+      return 0;
+
+   const auto entry = layer->commitData + static_cast<quint64>(pos) * (mHashSize + 16) + mHashSize + 8;
+
+   return (static_cast<qint64>(readU32(entry) & 0x3) << 32) | readU32(entry + 4);
+}
+
+quint64 GitCommitGraph::generation(quint32 pos) const
+{
+   if (!mHasCorrectedDates)
+      return topologicalLevel(pos);
+
+   auto localPos = pos;
+   const auto layer = layerFor(localPos);
+
+   if (!layer)
+      return 0;
+
+   quint64 offset = readU32(layer->generationData + static_cast<quint64>(localPos) * 4);
+
+   if (offset & GENERATION_OVERFLOW)
+   {
+      const auto index = offset & ~GENERATION_OVERFLOW;
+      offset = index < layer->generationOverflowCount ? readU64(layer->generationOverflow + index * 8) : 0;
+   }
+
+   return static_cast<quint64>(commitDate(pos)) + offset;
+}
+
+bool GitCommitGraph::maybeChangedPath(quint32 pos, const QByteArray &path) const
+{
+   const auto layer = layerFor(pos);
+
+   if (!layer || !layer->bloomIndexes || !layer->bloomData || path.isEmpty())
+      return true;
+
+   const auto end = readU32(layer->bloomIndexes + static_cast<quint64>(pos) * 4);
+   const auto start = pos == 0 ? 0u : readU32(layer->bloomIndexes + static_cast<quint64>(pos - 1) * 4);
+
+   if (end <= start || end > layer->bloomDataSize)
+      return true;
+
+   const auto filter = layer->bloomData + start;
+   const auto bitCount = static_cast<quint64>(end - start) * 8;
+
+   const auto contains = [layer, filter, bitCount](const char *key, int len) {
+      const auto hash0 = layer->bloomHashVersion == 1 ? murmur3<true>(BLOOM_SEED_0, key, len)
+                                                      : murmur3<false>(BLOOM_SEED_0, key, len);
+      const auto hash1 = layer->bloomHashVersion == 1 ? murmur3<true>(BLOOM_SEED_1, key, len)
+                                                      : murmur3<false>(BLOOM_SEED_1, key, len);
+
+      for (quint32 i = 0; i < layer->bloomHashCount; ++i)
+      {
+         const auto bit = static_cast<quint32>(hash0 + i * hash1) % bitCount;
+
+         if (!(filter[bit / 8] & (1 << (bit & 7))))
+            return false;
+      }
+
+      return true;
+   };
+
+   // Git adds the path and all its leading directories to the filter, so all of them must be there
+   for (auto len = path.size(); len > 0; len = path.lastIndexOf('/', len - 1))
+   {
+      if (!contains(path.constData(), static_cast<int>(len)))
+         return false;
+   }
+
+   return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <ObjectId.h>
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+// Reads objects/info/commit-graph (or the split chain in objects/info/commit-graphs) without spawning git. Commits are
+// addressed by their global position in the graph: the base layers of a chain come first, as git numbers them.
+class GitCommitGraph
+{
+public:
+   static constexpr quint32 NO_POSITION = 0xffffffff;
+
+   explicit GitCommitGraph(const QString &objectsDir);
+   ~GitCommitGraph();
+
+   bool load();
+   bool isValid() const { return mCommitCount > 0; }
+   // True when git wrote a new graph (gc, fetch, maintenance) after this one was loaded.
+   bool isStale() const;
+
+   int hashSize() const { return mHashSize; }
+   quint32 commitCount() const { return mCommitCount; }
+   bool hasBloomFilters() const { return mHasBloomFilters; }
+   bool hasCorrectedDates() const { return mHasCorrectedDates; }
+
+   quint32 findCommit(const QByteArray &rawOid) const;
+   quint32 findCommit(const QString &sha) const;
+   quint32 findCommit(const ObjectId &id) const;
+
+   QByteArray commitId(quint32 pos) const;
+   QString commitSha(quint32 pos) const;
+   QByteArray rootTree(quint32 pos) const;
+   QVector<quint32> parents(quint32 pos) const;
+   quint32 topologicalLevel(quint32 pos) const;
+   quint64 generation(quint32 pos) const;
+   qint64 commitDate(quint32 pos) const;
+
+   // False means the commit certainly didn't touch the path compared with its first parent. Commits without a stored
+   // Bloom filter always return true.
+   bool maybeChangedPath(quint32 pos, const QByteArray &path) const;
+
+private:
+   struct Layer;
+
+   QString mObjectsDir;
+   QVector<QSharedPointer<Layer>> mLayers;
+   QVector<qint64> mFileStamps;
+   quint32 mCommitCount = 0;
+   int mHashSize = 20;
+   bool mHasBloomFilters = false;
+   bool mHasCorrectedDates = false;
+
+   bool loadLayer(const QString &filePath, quint32 commitsInBase);
+   const Layer *layerFor(quint32 &pos) const;
+};
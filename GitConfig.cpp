@@ -1,11 +1,17 @@
 #include "GitConfig.h"
 
-#include <GitAsyncProcess.h>
 #include <GitBase.h>
 #include <GitCloneProcess.h>
+#include <GitConfigDatabase.h>
+
+#include <QSet>
+#include <QTimer>
 
 #include <QLogger.h>
 
+#include <algorithm>
+#include <iterator>
+
 using namespace QLogger;
 
 bool GitUserInfo::isValid() const
@@ -21,29 +27,16 @@ GitConfig::GitConfig(QSharedPointer<GitBase> gitBase, QObject *parent)
 
 GitUserInfo GitConfig::getGlobalUserInfo() const
 {
-   GitUserInfo userInfo;
-
    QLog_Debug("Git", QString("Getting global user info"));
 
-   const auto nameRequest = mGitBase->run("git config --get --global user.name");
-
-   if (nameRequest.success)
-      userInfo.mUserName = nameRequest.output.trimmed();
-
-   const auto emailRequest = mGitBase->run("git config --get --global user.email");
-
-   if (emailRequest.success)
-      userInfo.mUserEmail = emailRequest.output.trimmed();
-
-   return userInfo;
+   return userInfo(GitConfigDatabase::Scope::Global);
 }
 
 void GitConfig::setGlobalUserInfo(const GitUserInfo &info)
 {
    QLog_Debug("Git", QString("Setting global user info"));
 
-   mGitBase->run(QString("git config --global user.name \"%1\"").arg(info.mUserName));
-   mGitBase->run(QString("git config --global user.email %1").arg(info.mUserEmail));
+   setValues({ { "user.name", info.mUserName }, { "user.email", info.mUserEmail } }, GitConfigDatabase::Scope::Global);
 }
 
 GitExecResult GitConfig::setGlobalData(const QString &key, const QString &value)
@@ -52,6 +45,8 @@ GitExecResult GitConfig::setGlobalData(const QString &key, const QString &value)
 
    const auto ret = mGitBase->run(QString("git config --global %1 \"%2\"").arg(key, value));
 
+   mGitBase->getConfigDatabase()->invalidate();
+
    return ret;
 }
 
@@ -59,59 +54,32 @@ GitUserInfo GitConfig::getLocalUserInfo() const
 {
    QLog_Debug("Git", QString("Getting local user info"));
 
-   GitUserInfo userInfo;
-
-   const auto nameRequest = mGitBase->run("git config --get --local user.name");
-
-   if (nameRequest.success)
-      userInfo.mUserName = nameRequest.output.trimmed();
-
-   const auto emailRequest = mGitBase->run("git config --get --local user.email");
-
-   if (emailRequest.success)
-      userInfo.mUserEmail = emailRequest.output.trimmed();
-
-   return userInfo;
+   return userInfo(GitConfigDatabase::Scope::Local);
 }
 
 bool GitConfig::getUserNameAsync(bool local)
 {
-   QLog_Debug("Git", QString("Getting global config"));
+   QLog_Debug("Git", QString("Getting the user name"));
 
-   const auto p = new GitAsyncProcess(mGitBase->getWorkingDir());
-   connect(p, &GitAsyncProcess::signalDataReady, this, [this, local](GitExecResult ret) {
-      if (ret.success)
-         emit signalNameReceived(ret.output.trimmed(), local);
-   });
-
-   const auto ret
-       = p->run(QString("git config --get --%1 user.name").arg(QString::fromUtf8(local ? "local" : "global")));
+   emitValueLater("user.name", local, &GitConfig::signalNameReceived);
 
-   return ret.success;
+   return true;
 }
 
 bool GitConfig::getUserEmailAsync(bool local)
 {
-   QLog_Debug("Git", QString("Getting global config"));
+   QLog_Debug("Git", QString("Getting the user email"));
 
-   const auto p = new GitAsyncProcess(mGitBase->getWorkingDir());
-   connect(p, &GitAsyncProcess::signalDataReady, this, [this, local](GitExecResult ret) {
-      if (ret.success)
-         emit signalEmailReceived(ret.output.trimmed(), local);
-   });
+   emitValueLater("user.email", local, &GitConfig::signalEmailReceived);
 
-   const auto ret
-       = p->run(QString("git config --get --%1 user.email").arg(QString::fromUtf8(local ? "local" : "global")));
-
-   return ret.success;
+   return true;
 }
 
 void GitConfig::setLocalUserInfo(const GitUserInfo &info)
 {
    QLog_Debug("Git", QString("Setting local user info"));
 
-   mGitBase->run(QString("git config --local user.name \"%1\"").arg(info.mUserName));
-   mGitBase->run(QString("git config --local user.email %1").arg(info.mUserEmail));
+   setValues({ { "user.name", info.mUserName }, { "user.email", info.mUserEmail } }, GitConfigDatabase::Scope::Local);
 }
 
 GitExecResult GitConfig::setLocalData(const QString &key, const QString &value)
@@ -120,6 +88,8 @@ GitExecResult GitConfig::setLocalData(const QString &key, const QString &value)
 
    const auto ret = mGitBase->run(QString("git config --local %1 \"%2\"").arg(key, value));
 
+   mGitBase->getConfigDatabase()->invalidate();
+
    return ret;
 }
 
@@ -171,96 +141,102 @@ GitExecResult GitConfig::getRemoteForBranch(const QString &branch)
 {
    QLog_Debug("Git", QString("Getting remote for branch {%1}.").arg(branch));
 
-   const auto config = getLocalConfig();
+   const auto remote = mGitBase->getConfigDatabase()->value(QString("branch.%1.remote").arg(branch));
+
+   return remote.isEmpty() ? GitExecResult() : GitExecResult(true, remote);
+}
+
+QVector<GitConfigDatabase::Entry> GitConfig::getValues(const QStringList &keys) const
+{
+   QSet<QString> normalizedKeys;
+
+   for (const auto &key : keys)
+      normalizedKeys.insert(GitConfigDatabase::normalizeKey(key));
+
+   QVector<GitConfigDatabase::Entry> values;
+   const auto config = mGitBase->getConfigDatabase()->snapshot();
+
+   std::copy_if(config->entries.cbegin(), config->entries.cend(), std::back_inserter(values),
+                [&normalizedKeys](const auto &entry) { return normalizedKeys.contains(entry.key); });
+
+   return values;
+}
+
+QMap<QString, QString> GitConfig::getValues(const QStringList &keys, GitConfigDatabase::Scope scope) const
+{
+   QMap<QString, QString> values;
+   const auto config = mGitBase->getConfigDatabase()->snapshot();
 
-   if (config.success)
+   for (const auto &key : keys)
    {
-      const auto values = config.output.split('\n', Qt::SkipEmptyParts);
-      const auto configKey = QString("branch.%1.remote=").arg(branch);
-      QString configValue;
-
-      for (const auto &value : values)
-      {
-         if (value.startsWith(configKey))
-         {
-            configValue = value.split("=").last();
-            break;
-         }
-      }
-
-      if (!configValue.isEmpty())
-         return { true, configValue };
+      if (config->contains(key, scope))
+         values.insert(key, config->value(key, scope));
    }
 
-   return GitExecResult();
+   return values;
 }
 
-GitExecResult GitConfig::getGitValue(const QString &key) const
+GitExecResult GitConfig::setValues(const QVector<QPair<QString, QString>> &values, GitConfigDatabase::Scope scope)
 {
-   QLog_Debug("Git", QString("Getting value for config key {%1}").arg(key));
+   QLog_Debug("Git", QString("Writing {%1} config values").arg(values.count()));
 
-   const auto ret = mGitBase->run(QString("git config --get %1").arg(key));
+   QString error;
+   const auto written = mGitBase->getConfigDatabase()->setValues(scope, values, &error);
 
-   return ret;
+   return GitExecResult(written, error);
 }
 
-QString GitConfig::getServerUrl() const
+GitExecResult GitConfig::getGitValue(const QString &key) const
 {
-   auto serverUrl = getGitValue("remote.origin.url").output.trimmed();
+   QLog_Debug("Git", QString("Getting value for config key {%1}").arg(key));
 
-   if (serverUrl.startsWith("git@"))
-   {
-      serverUrl.remove("git@");
-      serverUrl.replace(":", "/");
-   }
+   // As with git config --get, a missing key is not an error and gives an empty output
+   return GitExecResult(true, mGitBase->getConfigDatabase()->value(key));
+}
 
-   serverUrl = serverUrl.mid(0, serverUrl.lastIndexOf("."));
+QVector<GitConfigDatabase::Remote> GitConfig::getRemotes() const
+{
+   return mGitBase->getConfigDatabase()->snapshot()->remotes;
+}
 
-   return serverUrl;
+GitConfigDatabase::Remote GitConfig::getRemote(const QString &name) const
+{
+   return mGitBase->getConfigDatabase()->snapshot()->remote(name);
 }
 
-QString GitConfig::getServerHost() const
+QString GitConfig::getServerUrl(const QString &remoteName) const
 {
-   auto serverUrl = getGitValue("remote.origin.url").output.trimmed();
+   const auto url = getRemote(remoteName).url;
 
-   if (serverUrl.startsWith("git@"))
-   {
-      serverUrl.remove("git@");
-      serverUrl.replace(":", "/");
-   }
-   else if (serverUrl.startsWith("https://"))
-   {
-      serverUrl.remove("https://");
-   }
+   if (!url.isValid() || url.isLocal())
+      return QString();
 
-   serverUrl = serverUrl.mid(0, serverUrl.indexOf("/"));
+   const auto path = url.owner.isEmpty() ? url.repo : QString("%1/%2").arg(url.owner, url.repo);
 
-   return serverUrl;
+   // Web addresses keep their scheme, SSH ones are given as host/owner/repo
+   if (url.scheme.startsWith("http"))
+      return QString("%1://%2/%3").arg(url.scheme, getServerHost(remoteName), path);
+
+   return QString("%1/%2").arg(getServerHost(remoteName), path);
 }
 
-QPair<QString, QString> GitConfig::getCurrentRepoAndOwner() const
+QString GitConfig::getServerHost(const QString &remoteName) const
 {
-   auto serverUrl = getGitValue("remote.origin.url").output.trimmed();
-   QString repo;
+   const auto url = getRemote(remoteName).url;
 
-   if (serverUrl.startsWith("git@"))
-   {
-      serverUrl.remove("git@");
-      repo = serverUrl.mid(serverUrl.lastIndexOf(":") + 1);
-      serverUrl.replace(":", "/");
-   }
-   else if (serverUrl.startsWith("https://"))
-   {
-      serverUrl.remove("https://");
-      repo = serverUrl.mid(serverUrl.indexOf("/") + 1);
-   }
+   // The port of an SSH remote is not the one of the web and API services, so only http(s) remotes keep it
+   if (url.port < 0 || !url.scheme.startsWith("http"))
+      return url.host;
 
-   serverUrl = serverUrl.mid(0, serverUrl.indexOf("/"));
-   repo.remove(".git");
+   return QString("%1:%2").arg(url.host).arg(url.port);
+}
 
-   const auto parts = repo.split("/");
+QPair<QString, QString> GitConfig::getCurrentRepoAndOwner(const QString &remoteName) const
+{
+   const auto url = getRemote(remoteName).url;
 
-   return qMakePair(parts.constFirst(), parts.constLast());
+   // For nested owners, such as GitLab subgroups, the owner is the top-level one
+   return qMakePair(url.owner.section('/', 0, 0), url.repo);
 }
 
 GitExecResult GitConfig::unset(const QString &key, bool isGlobal) const
@@ -270,5 +246,29 @@ GitExecResult GitConfig::unset(const QString &key, bool isGlobal) const
    const auto ret
        = mGitBase->run(QString("git config %1 --unset %2").arg(QString::fromUtf8(isGlobal ? "--global" : ""), key));
 
+   mGitBase->getConfigDatabase()->invalidate();
+
    return ret;
 }
+
+GitUserInfo GitConfig::userInfo(GitConfigDatabase::Scope scope) const
+{
+   const auto values = getValues({ "user.name", "user.email" }, scope);
+
+   GitUserInfo userInfo;
+   userInfo.mUserName = values.value("user.name");
+   userInfo.mUserEmail = values.value("user.email");
+
+   return userInfo;
+}
+
+void GitConfig::emitValueLater(const QString &key, bool local, void (GitConfig::*signal)(QString, bool))
+{
+   const auto values = getValues({ key }, local ? GitConfigDatabase::Scope::Local : GitConfigDatabase::Scope::Global);
+
+   // Callers expect the answer once they are back in the event loop, as it came from a process before. A missing key
+   // gives an empty value, as git config --get did.
+   QTimer::singleShot(0, this, [this, signal, local, value = values.value(key)]() {
+      emit (this->*signal)(value, local);
+   });
+}
@@ -23,10 +23,13 @@
  ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***************************************************************************************/
 
+#include <QMap>
 #include <QObject>
 #include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
+#include <GitConfigDatabase.h>
 #include <GitExecResult.h>
 
 class GitBase;
@@ -67,12 +70,24 @@ public:
    GitExecResult getLocalConfig() const;
    GitExecResult getGlobalConfig() const;
    GitExecResult getRemoteForBranch(const QString &branch);
+   // Every value of the keys with the scope that sets it, in the order of git config --list --show-scope. No git
+   // process involved.
+   QVector<GitConfigDatabase::Entry> getValues(const QStringList &keys) const;
+   // The values of the keys that one scope sets, as git config --get --<scope> gives them
+   QMap<QString, QString> getValues(const QStringList &keys, GitConfigDatabase::Scope scope) const;
+   // Writes all the values at once to the file of the scope
+   GitExecResult setValues(const QVector<QPair<QString, QString>> &values, GitConfigDatabase::Scope scope);
    GitExecResult getGitValue(const QString &key) const;
-   QString getServerUrl() const;
-   QString getServerHost() const;
-   QPair<QString, QString> getCurrentRepoAndOwner() const;
+   QVector<GitConfigDatabase::Remote> getRemotes() const;
+   GitConfigDatabase::Remote getRemote(const QString &name = QString("origin")) const;
+   QString getServerUrl(const QString &remoteName = QString("origin")) const;
+   QString getServerHost(const QString &remoteName = QString("origin")) const;
+   QPair<QString, QString> getCurrentRepoAndOwner(const QString &remoteName = QString("origin")) const;
    GitExecResult unset(const QString &key, bool isGlobal = false) const;
 
 private:
    QSharedPointer<GitBase> mGitBase;
+
+   GitUserInfo userInfo(GitConfigDatabase::Scope scope) const;
+   void emitValueLater(const QString &key, bool local, void (GitConfig::*signal)(QString, bool));
 };
@@ -0,0 +1,969 @@
+#include "GitConfigDatabase.h"
+
+#include <FileStamp.h>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStandardPaths>
+
+#include <QLogger.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(Q_OS_WIN)
+#   include <windows.h>
+#endif
+
+using namespace QLogger;
+
+namespace
+{
+// Same limit git has for nested includes
+constexpr int MAX_INCLUDE_DEPTH = 10;
+// Same limit git has when it follows the symbolic links of a file it locks
+constexpr int MAX_SYMLINK_DEPTH = 5;
+
+bool isSpace(char c)
+{
+   return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool isAlpha(char c)
+{
+   return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool isKeyChar(char c)
+{
+   return isAlpha(c) || (c >= '0' && c <= '9') || c == '-';
+}
+
+char toLower(char c)
+{
+   return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+QString expandHome(const QString &path)
+{
+   return path.startsWith("~/") ? QDir::homePath() + path.mid(1) : path;
+}
+
+// Wildcard matching with the rules of git's wildmatch in pathname mode: * and ? stop at slashes, ** doesn't
+QRegularExpression wildcardToRegularExpression(const QString &pattern, bool caseInsensitive)
+{
+   QString regex("^");
+
+   for (auto i = 0; i < pattern.length(); ++i)
+   {
+      const auto c = pattern.at(i);
+
+      if (c == '*' && i + 1 < pattern.length() && pattern.at(i + 1) == '*'
+          && (i == 0 || pattern.at(i - 1) == '/'))
+      {
+         if (i + 2 == pattern.length())
+         {
+            regex += ".*";
+            ++i;
+         }
+         else if (pattern.at(i + 2) == '/')
+         {
+            regex += "(?:.*/)?";
+            i += 2;
+         }
+         else
+            regex += "[^/]*";
+      }
+      else if (c == '*')
+         regex += "[^/]*";
+      else if (c == '?')
+         regex += "[^/]";
+      else if (c == '[' && pattern.indexOf(']', i + 2) > 0)
+      {
+         const auto end = pattern.indexOf(']', i + 2);
+         auto set = pattern.mid(i + 1, end - i - 1);
+
+         if (set.startsWith('!'))
+            set[0] = '^';
+
+         regex += QString("[%1]").arg(set.replace("\\", "\\\\"));
+         i = end;
+      }
+      else
+         regex += QRegularExpression::escape(c);
+   }
+
+   regex += "$";
+
+   return QRegularExpression(regex, caseInsensitive ? QRegularExpression::CaseInsensitiveOption
+                                                    : QRegularExpression::NoPatternOption);
+}
+
+class ConfigParser
+{
+public:
+   ConfigParser(const QString &gitDir, GitConfigDatabase::Snapshot &snapshot)
+      : mGitDir(gitDir)
+      , mSnapshot(snapshot)
+   {
+   }
+
+   void parseFile(const QString &filePath, GitConfigDatabase::Scope scope, int depth = 0);
+
+private:
+   QString mGitDir;
+   GitConfigDatabase::Snapshot &mSnapshot;
+   QString mBranch;
+   bool mBranchRead = false;
+
+   struct Cursor
+   {
+      const char *data;
+      int size;
+      int pos = 0;
+      bool eof = false;
+
+      // Returns '\n' at the end of the input, and for "\r\n"
+      char next()
+      {
+         if (pos >= size)
+         {
+            eof = true;
+            return '\n';
+         }
+
+         auto c = data[pos++];
+
+         if (c == '\r' && pos < size && data[pos] == '\n')
+            c = data[pos++];
+
+         return c;
+      }
+   };
+
+   bool parseSection(Cursor &cursor, QByteArray &section) const;
+   bool parseValue(Cursor &cursor, QByteArray &value) const;
+   void include(const QString &key, const QString &value, const QString &filePath, GitConfigDatabase::Scope scope,
+                int depth);
+   bool matchesCondition(const QString &condition, const QString &filePath);
+   QString currentBranch();
+};
+
+void ConfigParser::parseFile(const QString &filePath, GitConfigDatabase::Scope scope, int depth)
+{
+   mSnapshot.stamps.append(qMakePair(filePath, fileStamp(filePath)));
+
+   QFile file(filePath);
+
+   if (!file.open(QIODevice::ReadOnly))
+      return;
+
+   auto content = file.readAll();
+
+   if (content.startsWith("\xef\xbb\xbf"))
+      content.remove(0, 3);
+
+   Cursor cursor { content.constData(), static_cast<int>(content.size()) };
+   QByteArray section;
+
+   while (true)
+   {
+      const auto c = cursor.next();
+
+      if (cursor.eof)
+         return;
+
+      if (isSpace(c))
+         continue;
+
+      if (c == '#' || c == ';')
+      {
+         while (cursor.next() != '\n')
+            continue;
+
+         continue;
+      }
+
+      if (c == '[')
+      {
+         if (!parseSection(cursor, section))
+            break;
+
+         continue;
+      }
+
+      if (!isAlpha(c) || section.isEmpty())
+         break;
+
+      QByteArray name(1, toLower(c));
+      auto last = cursor.next();
+
+      while (!cursor.eof && isKeyChar(last))
+      {
+         name.append(toLower(last));
+         last = cursor.next();
+      }
+
+      while (last == ' ' || last == '\t')
+         last = cursor.next();
+
+      QByteArray value;
+      auto hasValue = false;
+
+      if (last != '\n')
+      {
+         if (last != '=' || !parseValue(cursor, value))
+            break;
+
+         hasValue = true;
+      }
+
+      GitConfigDatabase::Entry entry;
+      entry.key = QString::fromUtf8(section + '.' + name);
+      entry.value = hasValue ? QString::fromUtf8(value) : QString();
+      entry.scope = scope;
+      entry.filePath = filePath;
+
+      mSnapshot.index[entry.key].append(mSnapshot.entries.count());
+      mSnapshot.entries.append(entry);
+
+      include(entry.key, entry.value, filePath, scope, depth);
+   }
+
+   QLog_Warning("Git", QString("Bad config line {%1} in {%2}")
+                           .arg(content.left(cursor.pos).count('\n') + 1)
+                           .arg(filePath));
+}
+
+bool ConfigParser::parseSection(Cursor &cursor, QByteArray &section) const
+{
+   section.clear();
+
+   while (true)
+   {
+      auto c = cursor.next();
+
+      if (cursor.eof)
+         return false;
+
+      if (c == ']')
+         return !section.isEmpty();
+
+      if (isSpace(c))
+      {
+         // [section "subsection"]: the subsection keeps its case
+         while (isSpace(c) && !cursor.eof)
+            c = cursor.next();
+
+         if (c != '"')
+            return false;
+
+         section.append('.');
+
+         while (true)
+         {
+            c = cursor.next();
+
+            if (c == '\n')
+               return false;
+
+            if (c == '"')
+               break;
+
+            if (c == '\\' && (c = cursor.next()) == '\n')
+               return false;
+
+            section.append(c);
+         }
+
+         return cursor.next() == ']';
+      }
+
+      // The deprecated [section.subsection] is lower-cased as a whole
+      if (!isKeyChar(c) && c != '.')
+         return false;
+
+      section.append(toLower(c));
+   }
+}
+
+bool ConfigParser::parseValue(Cursor &cursor, QByteArray &value) const
+{
+   auto quoted = false;
+   auto comment = false;
+   auto spaces = 0;
+
+   value.clear();
+
+   while (true)
+   {
+      auto c = cursor.next();
+
+      if (c == '\n')
+         return !quoted;
+
+      if (comment)
+         continue;
+
+      // Whitespace outside quotes is dropped at the ends and kept between words
+      if (isSpace(c) && !quoted)
+      {
+         if (!value.isEmpty())
+            ++spaces;
+
+         continue;
+      }
+
+      if (!quoted && (c == ';' || c == '#'))
+      {
+         comment = true;
+         continue;
+      }
+
+      value.append(spaces, ' ');
+      spaces = 0;
+
+      if (c == '\\')
+      {
+         switch (c = cursor.next())
+         {
+            case '\n':
+               continue;
+            case 't':
+               c = '\t';
+               break;
+            case 'b':
+               c = '\b';
+               break;
+            case 'n':
+               c = '\n';
+               break;
+            case '\\':
+            case '"':
+               break;
+            default:
+               return false;
+         }
+
+         value.append(c);
+      }
+      else if (c == '"')
+         quoted = !quoted;
+      else
+         value.append(c);
+   }
+}
+
+void ConfigParser::include(const QString &key, const QString &value, const QString &filePath,
+                           GitConfigDatabase::Scope scope, int depth)
+{
+   if (!key.endsWith(".path") || value.isEmpty())
+      return;
+
+   if (key != "include.path")
+   {
+      if (!key.startsWith("includeif.") || key.count('.') < 2)
+         return;
+
+      const auto condition = key.mid(10, key.length() - 10 - 5);
+
+      if (!matchesCondition(condition, filePath))
+         return;
+   }
+
+   if (depth >= MAX_INCLUDE_DEPTH)
+   {
+      QLog_Warning("Git", QString("Too many nested includes reading {%1}").arg(filePath));
+      return;
+   }
+
+   auto path = expandHome(value);
+
+   if (QDir::isRelativePath(path))
+      path = QFileInfo(filePath).dir().filePath(path);
+
+   parseFile(QDir::cleanPath(path), scope, depth + 1);
+}
+
+bool ConfigParser::matchesCondition(const QString &condition, const QString &filePath)
+{
+   if (condition.startsWith("gitdir:") || condition.startsWith("gitdir/i:"))
+   {
+      const auto caseInsensitive = condition.startsWith("gitdir/i:");
+      auto pattern = expandHome(condition.mid(condition.indexOf(':') + 1));
+
+      if (pattern.startsWith("./"))
+         pattern = QFileInfo(filePath).dir().absolutePath() + pattern.mid(1);
+      else if (!QDir::isAbsolutePath(pattern))
+         pattern.prepend("**/");
+
+      if (pattern.endsWith('/'))
+         pattern.append("**");
+
+      const auto regex = wildcardToRegularExpression(pattern, caseInsensitive);
+      const auto canonicalGitDir = QFileInfo(mGitDir).canonicalFilePath();
+
+      return regex.match(mGitDir).hasMatch()
+          || (!canonicalGitDir.isEmpty() && regex.match(canonicalGitDir).hasMatch());
+   }
+
+   if (condition.startsWith("onbranch:"))
+   {
+      auto pattern = condition.mid(9);
+
+      if (pattern.endsWith('/'))
+         pattern.append("**");
+
+      const auto branch = currentBranch();
+
+      return !branch.isEmpty() && wildcardToRegularExpression(pattern, false).match(branch).hasMatch();
+   }
+
+   // hasconfig:remote.*.url needs the whole configuration first and is left out
+   QLog_Trace("Git", QString("Unsupported includeIf condition {%1}").arg(condition));
+
+   return false;
+}
+
+QString ConfigParser::currentBranch()
+{
+   if (!mBranchRead)
+   {
+      const auto headPath = QString("%1/HEAD").arg(mGitDir);
+      QFile head(headPath);
+
+      // The includes depend on HEAD from now on
+      mSnapshot.stamps.append(qMakePair(headPath, fileStamp(headPath)));
+      mBranchRead = true;
+
+      if (head.open(QIODevice::ReadOnly))
+      {
+         const auto content = QString::fromUtf8(head.readLine().trimmed());
+
+         if (content.startsWith("ref:"))
+         {
+            const auto ref = content.mid(4).trimmed();
+            mBranch = ref.startsWith("refs/heads/") ? ref.mid(11) : QString();
+         }
+      }
+   }
+
+   return mBranch;
+}
+
+// The URL with the longest matching prefix replaced, for url.<base>.insteadOf and url.<base>.pushInsteadOf
+QString rewriteUrl(const QString &url, const QVector<QPair<QString, QString>> &rewrites, bool *rewritten = nullptr)
+{
+   auto longest = -1;
+
+   for (auto i = 0; i < rewrites.count(); ++i)
+   {
+      const auto &prefix = rewrites.at(i).first;
+
+      if (url.startsWith(prefix) && (longest < 0 || prefix.length() > rewrites.at(longest).first.length()))
+         longest = i;
+   }
+
+   if (rewritten)
+      *rewritten = longest >= 0;
+
+   return longest < 0 ? url : rewrites.at(longest).second + url.mid(rewrites.at(longest).first.length());
+}
+
+QString quoteValue(const QString &value)
+{
+   QString quoted;
+   const auto needsQuotes = value.startsWith(' ') || value.startsWith('\t') || value.endsWith(' ')
+       || value.endsWith('\t') || value.contains(';') || value.contains('#');
+
+   for (const auto c : value)
+   {
+      if (c == '\\' || c == '"')
+         quoted += QString("\\%1").arg(c);
+      else if (c == '\n')
+         quoted += "\\n";
+      else if (c == '\t')
+         quoted += "\\t";
+      else if (c == '\b')
+         quoted += "\\b";
+      else
+         quoted += c;
+   }
+
+   return needsQuotes ? QString("\"%1\"").arg(quoted) : quoted;
+}
+
+// The normalized name of the section a header line opens, or a null string for other lines
+QString sectionOfHeader(const QString &line)
+{
+   static const QRegularExpression sectionHeader(
+       "^\\s*\\[\\s*([A-Za-z0-9.-]+)(?:\\s+\"((?:[^\"\\\\]|\\\\.)*)\")?\\s*\\]");
+
+   const auto match = sectionHeader.match(line);
+
+   if (!match.hasMatch())
+      return QString();
+
+   auto subsection = match.captured(2);
+   subsection.replace("\\\\", "\\").replace("\\\"", "\"");
+
+   return match.captured(1).toLower() + (match.capturedStart(2) < 0 ? QString("") : "." + subsection);
+}
+
+QString systemConfigPath()
+{
+   if (const auto path = qEnvironmentVariable("GIT_CONFIG_SYSTEM"); !path.isEmpty())
+      return path;
+
+#if defined(Q_OS_WIN)
+   // Git for Windows keeps it in its install dir, next to the cmd or bin folder holding git.exe
+   const auto git = QStandardPaths::findExecutable("git");
+
+   return git.isEmpty() ? QString() : QFileInfo(git).dir().filePath("../etc/gitconfig");
+#else
+   return QString("/etc/gitconfig");
+#endif
+}
+
+QStringList globalConfigPaths()
+{
+   if (const auto path = qEnvironmentVariable("GIT_CONFIG_GLOBAL"); !path.isEmpty())
+      return { expandHome(path) };
+
+   auto xdgConfigHome = qEnvironmentVariable("XDG_CONFIG_HOME");
+
+   if (xdgConfigHome.isEmpty())
+      xdgConfigHome = QDir::homePath() + "/.config";
+
+   return { xdgConfigHome + "/git/config", QDir::homePath() + "/.gitconfig" };
+}
+
+// Like git, the lock is taken next to the file a symbolic link points to, so the link itself is kept
+QString resolveSymLinks(const QString &filePath)
+{
+   auto resolved = filePath;
+
+   for (int depth = 0; depth < MAX_SYMLINK_DEPTH; ++depth)
+   {
+      const QFileInfo info(resolved);
+
+      if (!info.isSymLink() || info.symLinkTarget().isEmpty())
+         break;
+
+      resolved = info.symLinkTarget();
+   }
+
+   return resolved;
+}
+
+bool replaceFile(const QString &source, const QString &target)
+{
+#if defined(Q_OS_WIN)
+   const auto sourcePath = QDir::toNativeSeparators(source).toStdWString();
+   const auto targetPath = QDir::toNativeSeparators(target).toStdWString();
+
+   return MoveFileExW(sourcePath.c_str(), targetPath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+   return std::rename(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0;
+#endif
+}
+}
+
+bool GitConfigDatabase::Snapshot::contains(const QString &key) const
+{
+   return index.contains(normalizeKey(key));
+}
+
+bool GitConfigDatabase::Snapshot::contains(const QString &key, Scope scope) const
+{
+   const auto positions = index.value(normalizeKey(key));
+
+   return std::any_of(positions.cbegin(), positions.cend(), [this, scope](int position) {
+      return entries.at(position).scope == scope;
+   });
+}
+
+QString GitConfigDatabase::Snapshot::value(const QString &key, const QString &defaultValue) const
+{
+   const auto iter = index.constFind(normalizeKey(key));
+
+   return iter == index.cend() ? defaultValue : entries.at(iter.value().constLast()).value;
+}
+
+QStringList GitConfigDatabase::Snapshot::values(const QString &key) const
+{
+   QStringList result;
+   const auto positions = index.value(normalizeKey(key));
+
+   for (const auto position : positions)
+      result.append(entries.at(position).value);
+
+   return result;
+}
+
+bool GitConfigDatabase::Snapshot::boolValue(const QString &key, bool defaultValue) const
+{
+   const auto iter = index.constFind(normalizeKey(key));
+
+   return iter == index.cend() ? defaultValue : toBool(entries.at(iter.value().constLast()).value, defaultValue);
+}
+
+QString GitConfigDatabase::Snapshot::value(const QString &key, Scope scope, const QString &defaultValue) const
+{
+   const auto positions = index.value(normalizeKey(key));
+
+   for (auto i = positions.count() - 1; i >= 0; --i)
+   {
+      if (const auto &entry = entries.at(positions.at(i)); entry.scope == scope)
+         return entry.value;
+   }
+
+   return defaultValue;
+}
+
+GitConfigDatabase::Remote GitConfigDatabase::Snapshot::remote(const QString &name) const
+{
+   const auto iter = std::find_if(remotes.cbegin(), remotes.cend(), [&name](const Remote &remote) {
+      return remote.name == name;
+   });
+
+   return iter == remotes.cend() ? Remote() : *iter;
+}
+
+GitConfigDatabase::GitConfigDatabase(const QString &gitDir, const QString &commonDir)
+   : mGitDir(QDir::cleanPath(gitDir))
+   , mCommonDir(QDir::cleanPath(commonDir))
+{
+}
+
+GitConfigDatabase::~GitConfigDatabase() = default;
+
+QSharedPointer<const GitConfigDatabase::Snapshot> GitConfigDatabase::snapshot() const
+{
+   QMutexLocker lock(&mMutex);
+
+   if (mSnapshot)
+   {
+      const auto &stamps = mSnapshot->stamps;
+      const auto changed = std::any_of(stamps.cbegin(), stamps.cend(), [](const QPair<QString, qint64> &stamp) {
+         return fileStamp(stamp.first) != stamp.second;
+      });
+
+      if (!changed)
+         return mSnapshot;
+   }
+
+   mSnapshot = load();
+
+   return mSnapshot;
+}
+
+QString GitConfigDatabase::value(const QString &key, const QString &defaultValue) const
+{
+   return snapshot()->value(key, defaultValue);
+}
+
+QStringList GitConfigDatabase::values(const QString &key) const
+{
+   return snapshot()->values(key);
+}
+
+bool GitConfigDatabase::boolValue(const QString &key, bool defaultValue) const
+{
+   return snapshot()->boolValue(key, defaultValue);
+}
+
+bool GitConfigDatabase::setValues(Scope scope, const QVector<QPair<QString, QString>> &values, QString *error)
+{
+   static const QRegularExpression keyLine("^\\s*([A-Za-z][A-Za-z0-9-]*)\\s*(?:=|$|[;#])");
+   static const QRegularExpression validKey("^[A-Za-z0-9-]+(\\..*)?\\.[A-Za-z][A-Za-z0-9-]*$");
+
+   return editFile(scope, error, [&values](QStringList &lines, QString &failure) {
+      for (const auto &value : values)
+      {
+         const auto key = normalizeKey(value.first);
+
+         if (!validKey.match(key).hasMatch())
+         {
+            failure = QString("Invalid config key {%1}").arg(value.first);
+            return false;
+         }
+
+         const auto section = key.left(key.lastIndexOf('.'));
+         const auto name = key.mid(key.lastIndexOf('.') + 1);
+         const auto newLine = QString("\t%1 = %2").arg(name, quoteValue(value.second));
+         QString currentSection;
+         auto sectionEnd = -1;
+         QVector<int> keyLines;
+
+         for (auto i = 0; i < lines.count(); ++i)
+         {
+            if (const auto header = sectionOfHeader(lines.at(i)); !header.isNull())
+            {
+               currentSection = header;
+
+               if (currentSection == section)
+                  sectionEnd = i;
+
+               continue;
+            }
+
+            if (currentSection != section)
+               continue;
+
+            sectionEnd = i;
+
+            if (const auto match = keyLine.match(lines.at(i)); match.hasMatch() && match.captured(1).toLower() == name)
+               keyLines.append(i);
+         }
+
+         if (keyLines.count() > 1)
+         {
+            failure = QString("Can't replace {%1}: it has several values").arg(key);
+            return false;
+         }
+
+         // Lines continued on the next one are left in place: the new line after them wins, as the last value does
+         if (keyLines.count() == 1 && !lines.at(keyLines.constFirst()).trimmed().endsWith('\\'))
+            lines[keyLines.constFirst()] = newLine;
+         else if (sectionEnd >= 0)
+            lines.insert(sectionEnd + 1, newLine);
+         else
+         {
+            const auto dot = section.indexOf('.');
+            auto subsection = section.mid(dot + 1);
+            subsection.replace("\\", "\\\\").replace("\"", "\\\"");
+
+            lines.append(dot < 0 ? QString("[%1]").arg(section)
+                                 : QString("[%1 \"%2\"]").arg(section.left(dot), subsection));
+            lines.append(newLine);
+         }
+      }
+
+      return true;
+   });
+}
+
+bool GitConfigDatabase::removeSections(Scope scope, const QStringList &sections, QString *error)
+{
+   QSet<QString> removed;
+
+   for (const auto &section : sections)
+   {
+      const auto dot = section.indexOf('.');
+      removed.insert(dot < 0 ? section.toLower() : section.left(dot).toLower() + section.mid(dot));
+   }
+
+   return editFile(scope, error, [&removed](QStringList &lines, QString &) {
+      QStringList kept;
+      auto removing = false;
+
+      for (const auto &line : std::as_const(lines))
+      {
+         if (const auto header = sectionOfHeader(line); !header.isNull())
+            removing = removed.contains(header);
+
+         if (!removing)
+            kept.append(line);
+      }
+
+      lines = kept;
+
+      return true;
+   });
+}
+
+bool GitConfigDatabase::editFile(Scope scope, QString *error,
+                                 const std::function<bool(QStringList &, QString &)> &edit)
+{
+   const auto fail = [error](const QString &message) {
+      QLog_Warning("Git", message);
+
+      if (error)
+         *error = message;
+
+      return false;
+   };
+
+   QString filePath;
+
+   switch (scope)
+   {
+      case Scope::Local:
+         filePath = QString("%1/config").arg(mCommonDir);
+         break;
+      case Scope::Worktree:
+         filePath = QString("%1/config.worktree").arg(mGitDir);
+         break;
+      case Scope::Global: {
+         // Like git: the XDG file only when it is there and ~/.gitconfig isn't
+         const auto globalPaths = globalConfigPaths();
+         filePath = globalPaths.count() > 1 && QFileInfo::exists(globalPaths.constFirst())
+                 && !QFileInfo::exists(globalPaths.constLast())
+             ? globalPaths.constFirst()
+             : globalPaths.constLast();
+         break;
+      }
+      case Scope::System:
+         return fail("The system config can't be written");
+   }
+
+   // Git's lock protocol: the new content is written into <file>.lock, which is then renamed over the file
+   filePath = resolveSymLinks(filePath);
+   QFile lock(filePath + ".lock");
+
+   if (!lock.open(QIODevice::WriteOnly | QIODevice::NewOnly))
+      return fail(QString("Unable to lock {%1}").arg(filePath));
+
+   QFile file(filePath);
+   QStringList lines;
+
+   if (file.open(QIODevice::ReadOnly))
+   {
+      lines = QString::fromUtf8(file.readAll()).split('\n');
+      file.close();
+      lock.setPermissions(file.permissions());
+
+      if (lines.constLast().isEmpty())
+         lines.removeLast();
+   }
+
+   if (QString failure; !edit(lines, failure))
+   {
+      lock.remove();
+      return fail(QString("%1 in {%2}").arg(failure, filePath));
+   }
+
+   const auto content = (lines.join('\n') + '\n').toUtf8();
+   const auto written = lock.write(content) == content.size() && lock.flush();
+
+   lock.close();
+
+   if (!written || !replaceFile(lock.fileName(), filePath))
+   {
+      lock.remove();
+      return fail(QString("Unable to write {%1}").arg(filePath));
+   }
+
+   invalidate();
+
+   return true;
+}
+
+void GitConfigDatabase::invalidate()
+{
+   QMutexLocker lock(&mMutex);
+   mSnapshot.reset();
+}
+
+QString GitConfigDatabase::normalizeKey(const QString &key)
+{
+   const auto first = key.indexOf('.');
+   const auto last = key.lastIndexOf('.');
+
+   if (first < 0)
+      return key.toLower();
+
+   return key.left(first).toLower() + key.mid(first, last - first) + key.mid(last).toLower();
+}
+
+bool GitConfigDatabase::toBool(const QString &value, bool defaultValue)
+{
+   if (value.isNull())
+      return true;
+
+   const auto lower = value.toLower();
+
+   if (lower == "true" || lower == "yes" || lower == "on")
+      return true;
+
+   if (lower.isEmpty() || lower == "false" || lower == "no" || lower == "off")
+      return false;
+
+   auto isNumber = false;
+   const auto number = lower.toLongLong(&isNumber);
+
+   return isNumber ? number != 0 : defaultValue;
+}
+
+QSharedPointer<const GitConfigDatabase::Snapshot> GitConfigDatabase::load() const
+{
+   QLog_Trace("Git", QString("Reading the config files of {%1}").arg(mGitDir));
+
+   auto snapshot = QSharedPointer<Snapshot>::create();
+   ConfigParser parser(mGitDir, *snapshot);
+
+   if (!qEnvironmentVariableIsSet("GIT_CONFIG_NOSYSTEM"))
+   {
+      if (const auto systemPath = systemConfigPath(); !systemPath.isEmpty())
+         parser.parseFile(systemPath, Scope::System);
+   }
+
+   const auto globalPaths = globalConfigPaths();
+
+   for (const auto &globalPath : globalPaths)
+      parser.parseFile(globalPath, Scope::Global);
+
+   parser.parseFile(QString("%1/config").arg(mCommonDir), Scope::Local);
+
+   if (snapshot->boolValue("extensions.worktreeConfig", false))
+      parser.parseFile(QString("%1/config.worktree").arg(mGitDir), Scope::Worktree);
+
+   loadRemotes(*snapshot);
+
+   return snapshot;
+}
+
+void GitConfigDatabase::loadRemotes(Snapshot &snapshot)
+{
+   QVector<QPair<QString, QString>> rewrites;
+   QVector<QPair<QString, QString>> pushRewrites;
+   QStringList names;
+
+   for (const auto &entry : std::as_const(snapshot.entries))
+   {
+      const auto first = entry.key.indexOf('.');
+      const auto last = entry.key.lastIndexOf('.');
+
+      if (first == last)
+         continue;
+
+      const auto section = entry.key.left(first);
+      const auto subsection = entry.key.mid(first + 1, last - first - 1);
+      const auto name = entry.key.mid(last + 1);
+
+      if (section == "url" && name == "insteadof" && !entry.value.isEmpty())
+         rewrites.append(qMakePair(entry.value, subsection));
+      else if (section == "url" && name == "pushinsteadof" && !entry.value.isEmpty())
+         pushRewrites.append(qMakePair(entry.value, subsection));
+      else if (section == "remote" && (name == "url" || name == "pushurl") && !names.contains(subsection))
+         names.append(subsection);
+   }
+
+   for (const auto &name : std::as_const(names))
+   {
+      // Fetching uses the first URL when there are several
+      const auto url = snapshot.values(QString("remote.%1.url").arg(name)).value(0);
+      const auto pushUrl = snapshot.values(QString("remote.%1.pushurl").arg(name)).value(0);
+
+      Remote remote;
+      remote.name = name;
+      remote.url = GitRemoteUrl::parse(rewriteUrl(url, rewrites));
+
+      if (!pushUrl.isEmpty())
+         remote.pushUrl = GitRemoteUrl::parse(rewriteUrl(pushUrl, rewrites));
+      else
+      {
+         auto pushRewritten = false;
+         const auto rewrittenUrl = rewriteUrl(url, pushRewrites, &pushRewritten);
+
+         remote.pushUrl = pushRewritten ? GitRemoteUrl::parse(rewrittenUrl) : remote.url;
+      }
+
+      snapshot.remotes.append(remote);
+   }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <GitRemoteUrl.h>
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+// Reads the git configuration files directly: system, global, the repository config and config.worktree, following
+// include.path and includeIf.<condition>.path. The parsed result is kept until one of the files it came from changes.
+class GitConfigDatabase
+{
+public:
+   enum class Scope
+   {
+      System,
+      Global,
+      Local,
+      Worktree
+   };
+
+   struct Entry
+   {
+      // Normalized as git does: section and name in lower case, the subsection as written
+      QString key;
+      // Null for a key without '=', which git takes as a true boolean
+      QString value;
+      Scope scope = Scope::Local;
+      QString filePath;
+   };
+
+   // A remote with url.<base>.insteadOf and pushInsteadOf already applied
+   struct Remote
+   {
+      QString name;
+      GitRemoteUrl url;
+      // remote.<name>.pushurl, or the URL push uses when there is none
+      GitRemoteUrl pushUrl;
+   };
+
+   struct Snapshot
+   {
+      QVector<Entry> entries;
+      // Positions in entries of each key, in file order
+      QHash<QString, QVector<int>> index;
+      // Every file read or looked for, with the stamp it had
+      QVector<QPair<QString, qint64>> stamps;
+      // In the order they are first configured
+      QVector<Remote> remotes;
+
+      bool contains(const QString &key) const;
+      bool contains(const QString &key, Scope scope) const;
+      // The last value wins, as in git config --get
+      QString value(const QString &key, const QString &defaultValue = QString()) const;
+      // The value a single scope gives, as in git config --get --global
+      QString value(const QString &key, Scope scope, const QString &defaultValue = QString()) const;
+      QStringList values(const QString &key) const;
+      bool boolValue(const QString &key, bool defaultValue) const;
+      Remote remote(const QString &name) const;
+   };
+
+   GitConfigDatabase(const QString &gitDir, const QString &commonDir);
+   ~GitConfigDatabase();
+
+   // The current configuration. Costs a stat of each file it was read from.
+   QSharedPointer<const Snapshot> snapshot() const;
+
+   QString value(const QString &key, const QString &defaultValue = QString()) const;
+   QStringList values(const QString &key) const;
+   bool boolValue(const QString &key, bool defaultValue) const;
+
+   // Writes all the values to the file of the scope at once, holding its lock as git does. Keys set more than once
+   // in that file can't be replaced and fail the whole batch. The system scope isn't writable.
+   bool setValues(Scope scope, const QVector<QPair<QString, QString>> &values, QString *error = nullptr);
+   // Removes whole sections, such as branch.<name>, in one write
+   bool removeSections(Scope scope, const QStringList &sections, QString *error = nullptr);
+   // For changes made through git config: a file rewritten within the same tick could go unnoticed
+   void invalidate();
+
+   static QString normalizeKey(const QString &key);
+   static bool toBool(const QString &value, bool defaultValue);
+
+private:
+   QString mGitDir;
+   QString mCommonDir;
+   mutable QMutex mMutex;
+   mutable QSharedPointer<const Snapshot> mSnapshot;
+
+   QSharedPointer<const Snapshot> load() const;
+   bool editFile(Scope scope, QString *error, const std::function<bool(QStringList &, QString &)> &edit);
+   static void loadRemotes(Snapshot &snapshot);
+};
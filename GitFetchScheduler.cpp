@@ -0,0 +1,182 @@
+#include "GitFetchScheduler.h"
+
+#include <GitAsyncProcess.h>
+#include <GitBase.h>
+#include <GitConfigDatabase.h>
+#include <GitNetworkProcess.h>
+
+#include <QFile>
+#include <QRegularExpression>
+
+#include <QLogger.h>
+
+using namespace QLogger;
+
+namespace
+{
+const QRegularExpression REF_UPDATE_LINE(
+    "^ ([ +\\-t*!=]) (\\[[^\\]]+\\]|\\S+)\\s+(\\S+)\\s+->\\s+(\\S+)(?:\\s+\\((.+)\\))?$");
+}
+
+GitFetchScheduler::GitFetchScheduler(const QSharedPointer<GitBase> &gitBase, QObject *parent)
+   : QObject(parent)
+   , mGitBase(gitBase)
+{
+   qRegisterMetaType<GitFetchScheduler::FetchResult>("GitFetchScheduler::FetchResult");
+}
+
+GitFetchScheduler::~GitFetchScheduler()
+{
+   mQueued.clear();
+
+   for (const auto process : std::as_const(mRunning))
+   {
+      disconnect(process, nullptr, this, nullptr);
+      process->cancel();
+   }
+}
+
+void GitFetchScheduler::setMaxConcurrent(int maxConcurrent)
+{
+   mMaxConcurrent = qMax(1, maxConcurrent);
+}
+
+bool GitFetchScheduler::fetch(bool prune)
+{
+   const auto config = mGitBase->getConfigDatabase()->snapshot();
+   QStringList remotes;
+
+   for (const auto &remote : config->remotes)
+   {
+      if (!config->boolValue(QString("remote.%1.skipdefaultupdate").arg(remote.name), false))
+         remotes.append(remote.name);
+   }
+
+   return fetch(remotes, prune);
+}
+
+bool GitFetchScheduler::fetch(const QStringList &remotes, bool prune)
+{
+   if (isRunning() || remotes.isEmpty())
+      return false;
+
+   QLog_Debug("Git", QString("Fetching {%1} remotes, {%2} at a time").arg(remotes.count()).arg(mMaxConcurrent));
+
+   mQueued = remotes;
+   mQueued.removeDuplicates();
+   mPrune = prune;
+   mSuccess = true;
+
+   // Every fetch appends its refs to FETCH_HEAD, so it starts empty for the batch
+   QFile fetchHead(QString("%1/FETCH_HEAD").arg(mGitBase->getGitDir()));
+
+   if (fetchHead.exists())
+      fetchHead.resize(0);
+
+   startNext();
+
+   return true;
+}
+
+void GitFetchScheduler::cancel()
+{
+   if (!isRunning())
+      return;
+
+   QLog_Debug("Git", QString("Canceling the fetch of {%1} remotes").arg(mRunning.count() + mQueued.count()));
+
+   mQueued.clear();
+   mSuccess = false;
+
+   // The processes report their end even when killed, and the last one closes the batch
+   for (const auto process : std::as_const(mRunning))
+      process->cancel();
+}
+
+QVector<GitFetchScheduler::RefUpdate> GitFetchScheduler::parseRefUpdates(const QStringList &lines)
+{
+   QVector<RefUpdate> updates;
+
+   for (const auto &line : lines)
+   {
+      const auto match = REF_UPDATE_LINE.match(line);
+
+      // Up to date refs are only listed with --verbose, but they aren't updates either way
+      if (match.hasMatch() && match.captured(1) != "=")
+      {
+         updates.append({ match.captured(1).at(0), match.captured(2), match.captured(3), match.captured(4),
+                          match.captured(5) });
+      }
+   }
+
+   return updates;
+}
+
+void GitFetchScheduler::startNext()
+{
+   while (mRunning.count() < mMaxConcurrent && !mQueued.isEmpty())
+   {
+      const auto remote = mQueued.takeFirst();
+      const auto process = new GitNetworkProcess(mGitBase->getWorkingDir());
+
+      connect(process, &GitNetworkProcess::signalProgress, this,
+              [this, remote](const GitProgress &progress) { emit signalRemoteProgress(remote, progress); });
+      connect(process, &GitNetworkProcess::signalFinished, this,
+              [this, remote, process](const GitExecResult &result) { onRemoteFinished(remote, process, result); });
+
+      // --append and no gc or commit-graph: several of them write at the same time, the maintenance runs once
+      const auto cmd
+          = QString("git fetch --progress --tags --force %1 --append --no-auto-gc --no-write-commit-graph %2")
+                .arg(mPrune ? QString("--prune --prune-tags") : QString(), remote);
+
+      mRunning.insert(remote, process);
+
+      if (!process->runAsync(cmd))
+      {
+         mRunning.remove(remote);
+         process->deleteLater();
+         onRemoteFinished(remote, nullptr, { false, QString("Unable to start the fetch of %1").arg(remote) });
+      }
+   }
+}
+
+void GitFetchScheduler::onRemoteFinished(const QString &remote, GitNetworkProcess *process,
+                                         const GitExecResult &result)
+{
+   FetchResult fetchResult;
+   fetchResult.remote = remote;
+   fetchResult.success = result.success;
+   fetchResult.output = result.output;
+
+   if (process)
+   {
+      mRunning.remove(remote);
+      fetchResult.updatedRefs = parseRefUpdates(process->messages());
+   }
+
+   QLog_Debug("Git",
+              QString("Fetch of {%1} %2 with {%3} updated refs")
+                  .arg(remote, result.success ? QString("succeeded") : QString("failed"))
+                  .arg(fetchResult.updatedRefs.count()));
+
+   mSuccess = mSuccess && result.success;
+
+   emit signalRemoteFetched(fetchResult);
+
+   if (!mQueued.isEmpty())
+      startNext();
+   else if (mRunning.isEmpty())
+      finishBatch();
+}
+
+void GitFetchScheduler::finishBatch()
+{
+   if (mSuccess)
+   {
+      // What each fetch skipped, once for all of them
+      const auto maintenance = new GitAsyncProcess(mGitBase->getWorkingDir());
+      maintenance->run("git maintenance run --auto");
+   }
+
+   emit signalFinished(mSuccess);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <GitExecResult.h>
+#include <GitProgressParser.h>
+
+#include <QMap>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+class GitBase;
+class GitNetworkProcess;
+
+// Fetches several remotes at the same time, each one in its own git fetch, as git fetch --multiple --jobs does. The
+// remotes beyond the concurrency limit wait for a slot.
+class GitFetchScheduler : public QObject
+{
+   Q_OBJECT
+
+public:
+   // One of the ref lines fetch prints, as " + 1a2b3c...4d5e6f master -> origin/master  (forced update)"
+   struct RefUpdate
+   {
+      // ' ' fast-forward, '+' forced, '-' pruned, 't' tag moved, '*' new ref, '!' rejected
+      QChar flag;
+      // The old..new range, or the bracketed summary: "[new branch]", "[deleted]", "[rejected]"...
+      QString summary;
+      QString from;
+      QString to;
+      QString reason;
+   };
+
+   struct FetchResult
+   {
+      QString remote;
+      bool success = false;
+      // The messages of git, or why it failed
+      QString output;
+      QVector<RefUpdate> updatedRefs;
+   };
+
+signals:
+   void signalRemoteProgress(QString remote, GitProgress progress);
+   void signalRemoteFetched(GitFetchScheduler::FetchResult result);
+   // All the remotes were fetched, or the batch was canceled
+   void signalFinished(bool success);
+
+public:
+   explicit GitFetchScheduler(const QSharedPointer<GitBase> &gitBase, QObject *parent = nullptr);
+   ~GitFetchScheduler() override;
+
+   void setMaxConcurrent(int maxConcurrent);
+
+   // Every remote but the ones with remote.<name>.skipDefaultUpdate, like git fetch --all
+   bool fetch(bool prune = false);
+   // False when a batch is already running or there is nothing to fetch
+   bool fetch(const QStringList &remotes, bool prune = false);
+   // Stops the running fetches and drops the queued ones. signalFinished is emitted with false as soon as the git
+   // processes end, even if a transport helper they started (ssh, upload-pack) is still closing.
+   void cancel();
+   bool isRunning() const { return !mRunning.isEmpty() || !mQueued.isEmpty(); }
+
+   static QVector<RefUpdate> parseRefUpdates(const QStringList &lines);
+
+private:
+   QSharedPointer<GitBase> mGitBase;
+   int mMaxConcurrent = 4;
+   bool mPrune = false;
+   bool mSuccess = true;
+   QStringList mQueued;
+   QMap<QString, GitNetworkProcess *> mRunning;
+
+   void startNext();
+   void onRemoteFinished(const QString &remote, GitNetworkProcess *process, const GitExecResult &result);
+   void finishBatch();
+};
+
+Q_DECLARE_METATYPE(GitFetchScheduler::FetchResult)
@@ -1,14 +1,329 @@
 #include "GitHistory.h"
 
 #include <GitBase.h>
+#include <GitCommitGraph.h>
 #include <GitConfig.h>
+#include <GitObjectDatabase.h>
+#include <GitTreeDiff.h>
 
 #include <QLogger.h>
 
+#include <QBitArray>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSet>
 #include <QStringLiteral>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+#if defined(Q_OS_UNIX)
+#   include <unistd.h>
+#endif
 
 using namespace QLogger;
 
+namespace
+{
+// Most files a single process of the streamed branch diff is given
+constexpr int MAX_SHARD_FILES = 100;
+
+// The diff of each file of a shard of the streamed branch diff
+struct ShardDiff
+{
+   GitExecResult result;
+   QStringList diffs;
+   qint64 bytes = 0;
+};
+
+// Where a paged history walk stopped, so the next page doesn't walk again from HEAD. Positions are only valid for the
+// graph they were taken from.
+struct HistoryWalk
+{
+   QSharedPointer<GitCommitGraph> graph;
+   std::priority_queue<QPair<qint64, quint32>> pending;
+   QBitArray visited;
+   // Confirmed by git, newest first
+   QStringList commits;
+};
+
+QMutex historyWalksMutex;
+QCache<QString, HistoryWalk> historyWalks(8);
+
+// The object at path inside the tree, null when the path doesn't exist there. False when some tree can't be read.
+bool findPathEntry(const GitObjectDatabase &objects, ObjectId tree, const QString &path, ObjectId &entry)
+{
+   const auto components = path.split('/', Qt::SkipEmptyParts);
+
+   entry = ObjectId();
+
+   for (auto i = 0; i < components.count(); ++i)
+   {
+      QVector<GitObjectDatabase::TreeEntry> entries;
+
+      if (!objects.readTree(tree, entries))
+         return false;
+
+      const auto found = std::find_if(entries.cbegin(), entries.cend(), [&components, i](const auto &treeEntry) {
+         return treeEntry.name == components.at(i);
+      });
+
+      if (found == entries.cend())
+         return true;
+
+      if (i == components.count() - 1)
+         entry = found->id;
+      else if (!found->isTree())
+         return true;
+
+      tree = found->id;
+   }
+
+   return true;
+}
+
+// The first parent of the merge with the same object at path, or -1 when it differs from all of them
+bool findTreeSameParent(const GitCommitGraph &graph, const GitObjectDatabase &objects, quint32 pos,
+                        const QString &path, int &sameParent)
+{
+   ObjectId entry;
+
+   sameParent = -1;
+
+   if (!findPathEntry(objects, ObjectId::fromRaw(graph.rootTree(pos)), path, entry))
+      return false;
+
+   const auto parents = graph.parents(pos);
+
+   for (auto i = 0; i < parents.count(); ++i)
+   {
+      ObjectId parentEntry;
+
+      if (parents.at(i) >= graph.commitCount()
+          || !findPathEntry(objects, ObjectId::fromRaw(graph.rootTree(parents.at(i))), path, parentEntry))
+      {
+         return false;
+      }
+
+      if (parentEntry == entry)
+      {
+         sameParent = i;
+         break;
+      }
+   }
+
+   return true;
+}
+
+// Same entries RevisionFiles reads from the diff-tree -C output: renamed files are replaced by their rename, and files
+// with a destination blob count as cached
+void appendChanges(RevisionFiles &files, const QVector<GitTreeDiff::Change> &changes,
+                   const QVector<GitRenameDetector::Match> &matches, int parent)
+{
+   QHash<int, GitRenameDetector::Match> matchByDestination;
+   QSet<int> renamedSources;
+
+   for (const auto &match : matches)
+   {
+      matchByDestination.insert(match.destination, match);
+
+      if (!match.isCopy)
+         renamedSources.insert(match.source);
+   }
+
+   for (auto i = 0; i < changes.count(); ++i)
+   {
+      const auto &change = changes.at(i);
+
+      if (renamedSources.contains(i))
+         continue;
+
+      if (const auto match = matchByDestination.constFind(i); match != matchByDestination.cend())
+      {
+         files.setExtStatus(changes.at(match->source).path, change.path, match->similarity, parent);
+         continue;
+      }
+
+      files.mFiles.append(change.path);
+      files.setStatus(QString(QLatin1Char(change.status)), !change.newId.isNull());
+      files.mergeParent.append(parent);
+   }
+}
+
+// The text of the link as git stores it. QFileInfo::symLinkTarget() resolves it to an absolute path instead.
+bool readSymLinkText(const QString &filePath, QByteArray &target)
+{
+#if defined(Q_OS_UNIX)
+   const auto encodedPath = QFile::encodeName(filePath);
+   QByteArray buffer(4096, '\0');
+   const auto length = ::readlink(encodedPath.constData(), buffer.data(), static_cast<size_t>(buffer.size()));
+
+   if (length < 0 || length >= buffer.size())
+      return false;
+
+   target = buffer.left(static_cast<int>(length));
+
+   return true;
+#elif QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+   target = QDir::fromNativeSeparators(QFileInfo(filePath).readSymLink()).toUtf8();
+
+   return !target.isEmpty();
+#else
+   Q_UNUSED(filePath)
+   Q_UNUSED(target)
+
+   return false;
+#endif
+}
+
+// Produces the same output as "git diff --no-index /dev/null <file>"
+QString newFileDiff(const QString &file, const QByteArray &content, const QString &mode)
+{
+   const auto blobHeader = QByteArray("blob ") + QByteArray::number(content.size()) + '\0';
+   const auto blobSha = QCryptographicHash::hash(blobHeader + content, QCryptographicHash::Sha1).toHex();
+
+   auto diff = QString("diff --git a/%1 b/%1\nnew file mode %2\nindex 0000000..%3\n")
+                   .arg(file, mode, QString::fromLatin1(blobSha.left(7)));
+
+   if (content.isEmpty())
+      return diff;
+
+   if (content.left(8000).contains('\0'))
+      return diff.append(QString("Binary files /dev/null and b/%1 differ\n").arg(file));
+
+   auto lines = content.split('\n');
+   const auto endsWithNewLine = content.endsWith('\n');
+
+   if (endsWithNewLine)
+      lines.removeLast();
+
+   diff.append(QString("--- /dev/null\n+++ b/%1\n").arg(file));
+   diff.append(lines.count() == 1 ? QString("@@ -0,0 +1 @@\n") : QString("@@ -0,0 +1,%1 @@\n").arg(lines.count()));
+
+   for (const auto &line : std::as_const(lines))
+      diff.append(QChar('+')).append(QString::fromUtf8(line)).append(QChar('\n'));
+
+   if (!endsWithNewLine)
+      diff.append("\\ No newline at end of file\n");
+
+   return diff;
+}
+
+// Undoes the C-style quoting git applies to paths with special characters when they aren't NUL-terminated
+QString unquotePath(const QString &path)
+{
+   if (path.size() < 2 || !path.startsWith('"') || !path.endsWith('"'))
+      return path;
+
+   const auto quoted = path.mid(1, path.size() - 2).toUtf8();
+   QByteArray raw;
+
+   for (auto i = 0; i < quoted.size(); ++i)
+   {
+      if (quoted.at(i) != '\\' || i + 1 == quoted.size())
+      {
+         raw.append(quoted.at(i));
+         continue;
+      }
+
+      const auto c = quoted.at(++i);
+
+      switch (c)
+      {
+         case 'a':
+            raw.append('\a');
+            break;
+         case 'b':
+            raw.append('\b');
+            break;
+         case 't':
+            raw.append('\t');
+            break;
+         case 'n':
+            raw.append('\n');
+            break;
+         case 'v':
+            raw.append('\v');
+            break;
+         case 'f':
+            raw.append('\f');
+            break;
+         case 'r':
+            raw.append('\r');
+            break;
+         default:
+            // Bytes outside ASCII come as three octal digits
+            if (c >= '0' && c <= '3' && i + 2 < quoted.size())
+            {
+               const auto byte = ((c - '0') << 6) | ((quoted.at(i + 1) - '0') << 3) | (quoted.at(i + 2) - '0');
+
+               raw.append(static_cast<char>(byte));
+               i += 2;
+            }
+            else
+               raw.append(c);
+            break;
+      }
+   }
+
+   return QString::fromUtf8(raw);
+}
+
+// The path as a pathspec that only matches itself, between the $ that splitArgList keeps as a single argument.
+// splitArgList removes every $, so a path with one is matched by a glob where ? takes its place.
+QString pathspecArgument(const QString &path)
+{
+   if (!path.contains('$'))
+      return QString("$:(literal)%1$").arg(path);
+
+   QString glob;
+
+   for (const auto &c : path)
+   {
+      if (c == '\\' || c == '*' || c == '?' || c == '[')
+         glob.append('\\');
+
+      glob.append(c == '$' ? QChar('?') : c);
+   }
+
+   return QString("$:(glob)%1$").arg(glob);
+}
+
+// splitArgList needs one of these characters to be missing from the command to split it
+bool hasFreeSeparator(const QString &command)
+{
+   const QString separators("#%&!?");
+
+   return std::any_of(separators.cbegin(), separators.cend(), [&command](QChar c) { return !command.contains(c); });
+}
+
+// Splits the output of git diff into the diff of each file
+QStringList splitFileDiffs(const QString &diff)
+{
+   QStringList files;
+   const QString header("\ndiff --git ");
+
+   for (auto start = 0; start < diff.size();)
+   {
+      const auto next = diff.indexOf(header, start);
+      const auto end = next == -1 ? diff.size() : next + 1;
+
+      files.append(diff.mid(start, end - start));
+      start = end;
+   }
+
+   return files;
+}
+}
+
 GitHistory::GitHistory(const QSharedPointer<GitBase> &gitBase)
    : mGitBase(gitBase)
 {
@@ -43,31 +358,355 @@ GitExecResult GitHistory::history(const QString &file)
    return ret;
 }
 
-GitExecResult GitHistory::getBranchesDiff(const QString &base, const QString &head)
+GitExecResult GitHistory::history(const QString &file, int skip, int maxCount)
 {
-   QLog_Debug("Git", QString("Getting diff between branches: {%1} and {%2}").arg(base, head));
+   QLog_Debug("Git",
+              QString("Executing paged history: {%1} skipping {%2}, max {%3}").arg(file).arg(skip).arg(maxCount));
 
-   QScopedPointer<GitConfig> git(new GitConfig(mGitBase));
+   const auto graph = mGitBase->getCommitGraph();
+   const auto objects = mGitBase->getObjectDatabase();
+   auto headPos = GitCommitGraph::NO_POSITION;
+   QString headSha;
 
-   QString fullBase = base;
-   auto retBase = git->getRemoteForBranch(base);
+   if (graph && graph->hasBloomFilters() && objects)
+   {
+      if (const auto head = mGitBase->getLastCommit(); head.success)
+      {
+         headSha = head.output.trimmed();
+         headPos = graph->findCommit(headSha);
+      }
+   }
 
-   if (retBase.success)
-      fullBase.prepend(retBase.output + QStringLiteral("/"));
+   // Without Bloom filters, or with HEAD newer than the graph, git log does the same filtering by itself
+   if (headPos == GitCommitGraph::NO_POSITION)
+      return historyByGit(file, skip, maxCount);
 
-   QString fullHead = head;
-   auto retHead = git->getRemoteForBranch(head);
+   auto path = QDir::cleanPath(file);
 
-   if (retHead.success)
-      fullHead.prepend(retHead.output + QStringLiteral("/"));
+   if (path.startsWith("./"))
+      path.remove(0, 2);
+
+   const auto key = path.toUtf8();
+   const auto needed = maxCount > 0 ? skip + maxCount : std::numeric_limits<int>::max();
+   const auto walkKey = QString("%1\n%2\n%3").arg(mGitBase->getGitDir(), headSha, path);
+
+   // The next page goes on from where the previous one stopped
+   QScopedPointer<HistoryWalk> walk;
+
+   {
+      QMutexLocker lock(&historyWalksMutex);
+      walk.reset(historyWalks.take(walkKey));
+   }
+
+   if (!walk || walk->graph != graph)
+   {
+      walk.reset(new HistoryWalk());
+      walk->graph = graph;
+      walk->visited = QBitArray(graph->commitCount());
+      walk->pending.push(qMakePair(graph->commitDate(headPos), headPos));
+      walk->visited.setBit(headPos);
+   }
+
+   QStringList candidates;
+
+   while (walk->commits.count() < needed && !walk->pending.empty())
+   {
+      const auto missing = needed - static_cast<int>(walk->commits.count());
+      const auto batchSize = missing > 240 ? 256 : missing + 16;
+
+      while (!walk->pending.empty() && candidates.count() < batchSize)
+      {
+         const auto pos = walk->pending.top().second;
+         walk->pending.pop();
+
+         auto parents = graph->parents(pos);
+         auto isCandidate = graph->maybeChangedPath(pos, key);
+
+         // Same simplification as git log -- file: a merge that kept the file of one of its parents isn't listed,
+         // and only that parent is followed. Filters are computed against the first parent, so a negative answer
+         // already tells it's that one.
+         if (parents.count() > 1)
+         {
+            auto sameParent = 0;
+
+            if (isCandidate && !findTreeSameParent(*graph, *objects, pos, path, sameParent))
+            {
+               QLog_Trace("Git", QString("Unable to read the trees of {%1}").arg(graph->commitSha(pos)));
+               return historyByGit(file, skip, maxCount);
+            }
+
+            if (sameParent >= 0)
+            {
+               parents = { parents.at(sameParent) };
+               isCandidate = false;
+            }
+         }
+
+         for (const auto parent : std::as_const(parents))
+         {
+            if (parent < graph->commitCount() && !walk->visited.testBit(parent))
+            {
+               walk->visited.setBit(parent);
+               walk->pending.push(qMakePair(graph->commitDate(parent), parent));
+            }
+         }
+
+         if (isCandidate)
+            candidates.append(graph->commitSha(pos));
+      }
+
+      if (candidates.isEmpty())
+         break;
+
+      // Bloom filters have false positives: git confirms the candidates keeping the order we give them
+      const auto cmd = QString("git log --no-walk=unsorted --pretty=%H %1 -- %2").arg(candidates.join(" "), file);
+
+      QLog_Trace("Git", QString("Confirming history candidates: {%1} commits").arg(candidates.count()));
 
-   const auto cmd = QString("git diff %1...%2").arg(fullBase, fullHead);
+      const auto ret = mGitBase->run(cmd);
+
+      if (!ret.success)
+         return ret;
+
+      walk->commits.append(ret.output.split('\n', Qt::SkipEmptyParts));
+      candidates.clear();
+   }
+
+   const QStringList page = walk->commits.mid(skip, maxCount > 0 ? maxCount : -1);
+
+   {
+      QMutexLocker lock(&historyWalksMutex);
+      historyWalks.insert(walkKey, walk.take());
+   }
+
+   return { !page.isEmpty(), page.join('\n') };
+}
+
+GitExecResult GitHistory::historyByGit(const QString &file, int skip, int maxCount) const
+{
+   const auto cmd = QString("git log --pretty=%H --skip=%1 --max-count=%2 -- %3")
+                        .arg(skip)
+                        .arg(maxCount > 0 ? maxCount : -1)
+                        .arg(file);
+
+   QLog_Trace("Git", QString("Executing paged history: {%1}").arg(cmd));
+
+   auto ret = mGitBase->run(cmd);
+
+   if (ret.success && ret.output.isEmpty())
+      ret.success = false;
+
+   return ret;
+}
+
+GitExecResult GitHistory::getBranchesDiff(const QString &base, const QString &head)
+{
+   QLog_Debug("Git", QString("Getting diff between branches: {%1} and {%2}").arg(base, head));
+
+   const auto branches = getFullBranchNames(base, head);
+   const auto cmd = QString("git diff %1...%2").arg(branches.first, branches.second);
 
    QLog_Trace("Git", QString("Getting diff between branches: {%1}").arg(cmd));
 
    return mGitBase->run(cmd);
 }
 
+GitExecResult GitHistory::getBranchesDiff(const QString &base, const QString &head,
+                                          const std::function<bool(const QString &, const QString &)> &onFileDiff,
+                                          int workerCount, qint64 maxBufferedBytes)
+{
+   QLog_Debug("Git", QString("Streaming diff between branches: {%1} and {%2}").arg(base, head));
+
+   const auto branches = getFullBranchNames(base, head);
+
+   // base...head is the diff from the merge base, so we resolve it once instead of once per file
+   const auto mergeBase = mGitBase->run(QString("git merge-base %1 %2").arg(branches.first, branches.second));
+
+   if (!mergeBase.success)
+      return mergeBase;
+
+   const auto from = mergeBase.output.trimmed();
+   const auto cmd = QString("git diff --name-status -M %1 %2").arg(from, branches.second);
+
+   QLog_Trace("Git", QString("Getting the changed files between branches: {%1}").arg(cmd));
+
+   const auto nameStatus = mGitBase->run(cmd);
+
+   if (!nameStatus.success)
+      return nameStatus;
+
+   // Each line is the status followed by the path, or by the source and destination paths for renames. Paths with
+   // tabs or newlines are quoted, so splitting can't cut them.
+   QVector<QStringList> entries;
+   const auto lines = nameStatus.output.split('\n', Qt::SkipEmptyParts);
+
+   for (const auto &line : lines)
+   {
+      auto paths = line.split('\t');
+
+      if (paths.count() < 2)
+         continue;
+
+      paths.removeFirst();
+
+      for (auto &path : paths)
+         path = unquotePath(path);
+
+      entries.append(paths);
+   }
+
+   const auto diffCommand = [&from, &branches](const QVector<QStringList> &shard) {
+      QStringList pathspecs;
+
+      for (const auto &paths : shard)
+         for (const auto &path : paths)
+            pathspecs.append(pathspecArgument(path));
+
+      return QString("git diff -M %1 %2 -- %3").arg(from, branches.second, pathspecs.join(' '));
+   };
+
+   // Consecutive files of the same directory share one git process. Keeping the shards in path order lets each one be
+   // delivered as soon as it's done.
+   QVector<QVector<QStringList>> shards;
+   QString shardDirectory;
+
+   for (const auto &paths : std::as_const(entries))
+   {
+      const auto directory = paths.constLast().section('/', 0, -2);
+
+      if (!shards.isEmpty() && directory == shardDirectory && shards.constLast().count() < MAX_SHARD_FILES)
+      {
+         auto shard = shards.constLast();
+         shard.append(paths);
+
+         if (hasFreeSeparator(diffCommand(shard)))
+         {
+            shards.last() = shard;
+            continue;
+         }
+      }
+
+      shards.append({ paths });
+      shardDirectory = directory;
+   }
+
+   // The diff of each file of the shard, in the same order. Rename detection only sees the files of the shard, so it
+   // can pair files that the full diff left apart: when the files don't match, they are diffed one by one.
+   const auto diffShard = [this, &diffCommand](const QVector<QStringList> &shard, QStringList &diffs) {
+      auto ret = mGitBase->run(diffCommand(shard));
+
+      if (!ret.success)
+         return ret;
+
+      diffs = splitFileDiffs(ret.output);
+
+      if (diffs.count() == shard.count())
+         return ret;
+
+      if (shard.count() == 1)
+         return GitExecResult(false, QString("Unexpected diff for {%1}").arg(shard.constFirst().constLast()));
+
+      diffs.clear();
+
+      for (const auto &paths : shard)
+      {
+         QStringList fileDiffs;
+
+         ret = mGitBase->run(diffCommand({ paths }));
+
+         if (!ret.success)
+            return ret;
+
+         if (fileDiffs = splitFileDiffs(ret.output); fileDiffs.count() != 1)
+            return GitExecResult(false, QString("Unexpected diff for {%1}").arg(paths.constLast()));
+
+         diffs.append(fileDiffs.constFirst());
+      }
+
+      return ret;
+   };
+
+   struct StreamState
+   {
+      QMutex mutex;
+      QWaitCondition changed;
+      QHash<int, ShardDiff> finished;
+      qint64 bufferedBytes = 0;
+      int next = 0;
+      bool stopped = false;
+   } state;
+
+   QThreadPool pool;
+   pool.setMaxThreadCount(workerCount > 0 ? workerCount : QThread::idealThreadCount());
+
+   // Tasks start in path order, so the one that has to be delivered next is always running or done. A task waits
+   // while the buffer is over budget unless it's the next to be delivered, which keeps the stream moving.
+   for (auto i = 0; i < shards.count(); ++i)
+   {
+      pool.start([i, &shards, &state, &diffShard, maxBufferedBytes]() {
+         {
+            QMutexLocker lock(&state.mutex);
+
+            while (!state.stopped && i != state.next && state.bufferedBytes >= maxBufferedBytes)
+               state.changed.wait(&state.mutex);
+
+            if (state.stopped)
+               return;
+         }
+
+         ShardDiff shardDiff;
+         shardDiff.result = diffShard(shards.at(i), shardDiff.diffs);
+
+         for (const auto &diff : std::as_const(shardDiff.diffs))
+            shardDiff.bytes += diff.size() * static_cast<qint64>(sizeof(QChar));
+
+         QMutexLocker lock(&state.mutex);
+         state.bufferedBytes += shardDiff.bytes;
+         state.finished.insert(i, shardDiff);
+         state.changed.wakeAll();
+      });
+   }
+
+   GitExecResult result { true, QString() };
+   auto keepStreaming = true;
+
+   QMutexLocker lock(&state.mutex);
+
+   while (keepStreaming && state.next < shards.count())
+   {
+      while (!state.finished.contains(state.next))
+         state.changed.wait(&state.mutex);
+
+      const auto shardDiff = state.finished.take(state.next);
+      const auto &shard = shards.at(state.next);
+
+      state.bufferedBytes -= shardDiff.bytes;
+      ++state.next;
+      state.changed.wakeAll();
+
+      lock.unlock();
+
+      if (!shardDiff.result.success)
+      {
+         result = shardDiff.result;
+         keepStreaming = false;
+      }
+
+      for (auto i = 0; keepStreaming && i < shard.count(); ++i)
+         keepStreaming = onFileDiff(shard.at(i).constLast(), shardDiff.diffs.at(i));
+
+      lock.relock();
+   }
+
+   state.stopped = true;
+   state.changed.wakeAll();
+   lock.unlock();
+
+   pool.waitForDone();
+
+   return result;
+}
+
 GitExecResult GitHistory::getCommitDiff(const QString &sha, const QString &diffToSha)
 {
    if (!sha.isEmpty())
@@ -158,30 +797,203 @@ GitExecResult GitHistory::getDiffFiles(const QString &sha, const QString &diffTo
    return mGitBase->run(runCmd);
 }
 
-GitExecResult GitHistory::getUntrackedFileDiff(const QString &file) const
+RevisionFiles GitHistory::getRevisionFiles(const QString &sha, const QString &diffToSha, int similarity,
+                                           int renameLimit)
 {
-   QLog_Debug("Git", QString("Getting diff for untracked file {%1}").arg(file));
+   const auto id = ObjectId::fromString(sha);
+   const auto diffToId = ObjectId::fromString(diffToSha);
+
+   // Names other than full SHAs are left to git
+   if (!id.isNull() && (diffToSha.isEmpty() || !diffToId.isNull()))
+      return getRevisionFiles(id, diffToId, similarity, renameLimit);
+
+   const auto ret = getDiffFiles(sha, diffToSha);
 
-   auto cmd = QString("git add --intent-to-add %1").arg(file);
+   return ret.success ? RevisionFiles(ret.output) : RevisionFiles();
+}
+
+RevisionFiles GitHistory::getRevisionFiles(const ObjectId &id, const ObjectId &diffToId, int similarity,
+                                           int renameLimit)
+{
+   QLog_Debug("Git",
+              QString("Getting modified files in-process between SHAs: {%1} to {%2}")
+                  .arg(id.toString(), diffToId.isNull() ? QString() : diffToId.toString()));
+
+   RevisionFiles files;
+
+   // The WIP has no objects to read
+   if (!id.isZero() && diffInProcess(id, { diffToId }, similarity, renameLimit, files))
+      return files;
+
+   const auto ret = getDiffFiles(id.toString(), diffToId.isNull() ? QString() : diffToId.toString());
+
+   return ret.success ? RevisionFiles(ret.output) : RevisionFiles();
+}
+
+QPair<QString, QString> GitHistory::getFullBranchNames(const QString &base, const QString &head)
+{
+   QScopedPointer<GitConfig> git(new GitConfig(mGitBase));
+
+   QString fullBase = base;
+   auto retBase = git->getRemoteForBranch(base);
+
+   if (retBase.success)
+      fullBase.prepend(retBase.output + QStringLiteral("/"));
+
+   QString fullHead = head;
+   auto retHead = git->getRemoteForBranch(head);
+
+   if (retHead.success)
+      fullHead.prepend(retHead.output + QStringLiteral("/"));
+
+   return qMakePair(fullBase, fullHead);
+}
+
+QHash<QString, RevisionFiles> GitHistory::getCommitsFiles(const QVector<QPair<QString, QString>> &commits)
+{
+   QLog_Debug("Git", QString("Getting modified files for {%1} commits").arg(commits.count()));
+
+   QStringList shas;
+   QByteArray input;
+
+   for (const auto &commit : commits)
+   {
+      if (commit.first.isEmpty() || commit.first == ZERO_SHA || shas.contains(commit.first))
+         continue;
+
+      // diff-tree --stdin only takes commits as parents: the empty tree is what --root already does for root commits
+      const auto parent = commit.second == INIT_SHA ? QString() : commit.second;
+
+      shas.append(commit.first);
+      input.append(QString("%1 %2").arg(commit.first, parent).trimmed().toLatin1()).append('\n');
+   }
+
+   QHash<QString, RevisionFiles> files;
+
+   if (shas.isEmpty())
+      return files;
+
+   // Without a second SHA, diff-tree -m compares a commit with each of its parents and --root a root with nothing
+   const auto objects = mGitBase->getObjectDatabase();
+   auto inProcess = true;
+
+   for (const auto &commit : commits)
+   {
+      if (!shas.contains(commit.first) || files.contains(commit.first))
+         continue;
+
+      const auto id = ObjectId::fromString(commit.first);
+      auto parents = QVector<ObjectId> { ObjectId::fromString(commit.second) };
 
-   QLog_Trace("Git", QString("Simulating we stage the file: {%1}").arg(cmd));
+      if (commit.second.isEmpty())
+      {
+         const auto object = objects->read(id);
+         parents = GitObjectDatabase::parseCommit(object.data).parents;
+
+         if (parents.isEmpty())
+            parents.append(ObjectId());
+      }
+
+      RevisionFiles commitFiles;
+
+      // A second name that isn't a full SHA is left to git
+      if ((!commit.second.isEmpty() && parents.constFirst().isNull())
+          || !diffInProcess(id, parents, GitRenameDetector::DEFAULT_SIMILARITY, GitRenameDetector::DEFAULT_RENAME_LIMIT,
+                            commitFiles))
+      {
+         inProcess = false;
+         break;
+      }
+
+      files.insert(commit.first, commitFiles);
+   }
+
+   if (inProcess)
+      return files;
 
-   if (auto ret = mGitBase->run(cmd); ret.success)
+   files.clear();
+
+   // --always prints the commit header even when there are no changes, so every commit gets its own block
+   const auto cmd = QString("git diff-tree --stdin --always -C --no-color -r -m --root");
+
+   QLog_Trace("Git", QString("Getting modified files for many commits: {%1}").arg(cmd));
+
+   const auto ret = mGitBase->run(cmd, input);
+
+   if (!ret.success)
+      return files;
+
+   // A commit header starts the block of the next commit. Merges repeat the header once per parent: those lines stay
+   // in the block so RevisionFiles numbers the parents as it does for a single diff-tree call.
+   auto current = -1;
+   QString block;
+   const auto lines = ret.output.split('\n', Qt::SkipEmptyParts);
+
+   for (const auto &line : lines)
    {
-      cmd = QString("git diff %1").arg(file);
+      if (line.startsWith(':'))
+         block.append(line).append('\n');
+      else if (current >= 0 && line == shas.at(current))
+         block.append(line).append('\n');
+      else if (const auto next = shas.indexOf(line, current + 1); next != -1)
+      {
+         if (current >= 0)
+            files.insert(shas.at(current), RevisionFiles(block));
 
-      QLog_Trace("Git", QString("Getting diff for untracked file: {%1}").arg(cmd));
+         current = next;
+         block.clear();
+      }
+   }
 
-      const auto retDiff = mGitBase->run(cmd);
+   if (current >= 0)
+      files.insert(shas.at(current), RevisionFiles(block));
 
-      QLog_Trace("Git", QString("Resetting the file to its previous state: {%1}").arg(cmd));
+   return files;
+}
 
-      cmd = QString("git reset %1").arg(file);
+bool GitHistory::diffInProcess(const ObjectId &id, const QVector<ObjectId> &parents, int similarity, int renameLimit,
+                               RevisionFiles &files) const
+{
+   const auto objects = mGitBase->getObjectDatabase();
+   const GitTreeDiff treeDiff(objects);
+   GitRenameDetector renameDetector(objects);
+   renameDetector.setSimilarity(similarity);
+   renameDetector.setRenameLimit(renameLimit);
+
+   files = RevisionFiles();
 
-      mGitBase->run(cmd);
+   for (auto i = 0; i < parents.count(); ++i)
+   {
+      QVector<GitTreeDiff::Change> changes;
 
-      return { true, retDiff.output };
+      if (!treeDiff.diffCommits(parents.at(i), id, changes))
+         return false;
+
+      appendChanges(files, changes, renameDetector.detect(changes), i + 1);
    }
-   else
-      return { false, "" };
+
+   return true;
+}
+
+GitExecResult GitHistory::getUntrackedFileDiff(const QString &file) const
+{
+   QLog_Debug("Git", QString("Getting diff for untracked file {%1}").arg(file));
+
+   const QFileInfo info(QString("%1/%2").arg(mGitBase->getWorkingDir(), file));
+
+   // Building the diff here avoids staging the file with --intent-to-add and resetting it afterwards, which rewrites
+   // the index twice and competes for index.lock with anything else running in the repository.
+   if (info.isSymLink())
+   {
+      if (QByteArray target; readSymLinkText(info.filePath(), target))
+         return { true, newFileDiff(file, target, "120000") };
+   }
+   else if (QFile f(info.filePath()); info.isFile() && f.open(QIODevice::ReadOnly))
+      return { true, newFileDiff(file, f.readAll(), info.isExecutable() ? "100755" : "100644") };
+
+   const auto cmd = QString("git diff --no-index -- /dev/null %1").arg(file);
+
+   QLog_Trace("Git", QString("Getting diff for untracked file: {%1}").arg(cmd));
+
+   return mGitBase->run(cmd);
 }
@@ -24,9 +24,15 @@
  ***************************************************************************************/
 
 #include <GitExecResult.h>
+#include <GitRenameDetector.h>
+#include <ObjectId.h>
+#include <RevisionFiles.h>
 
+#include <QHash>
 #include <QSharedPointer>
 
+#include <functional>
+
 class GitBase;
 
 class GitHistory
@@ -36,7 +42,17 @@ public:
 
    GitExecResult blame(const QString &file, const QString &commitFrom);
    GitExecResult history(const QString &file);
+   // Paged history of a file that uses the commit-graph Bloom filters to skip commits when they are available. Same
+   // commits as git log -- file, merges simplified the same way. It doesn't follow renames. The walk is kept between
+   // calls, so asking for the next page doesn't start over from HEAD.
+   GitExecResult history(const QString &file, int skip, int maxCount);
    GitExecResult getBranchesDiff(const QString &base, const QString &head);
+   // Streams the diff between two branches file by file in path order. The files of each directory are diffed together
+   // in parallel by up to workerCount git processes, and roughly maxBufferedBytes of finished diffs are kept waiting
+   // for delivery. Returning false from onFileDiff stops the stream.
+   GitExecResult getBranchesDiff(const QString &base, const QString &head,
+                                 const std::function<bool(const QString &file, const QString &diff)> &onFileDiff,
+                                 int workerCount = 0, qint64 maxBufferedBytes = 32 * 1024 * 1024);
    GitExecResult getCommitDiff(const QString &sha, const QString &diffToSha);
    GitExecResult getFileDiff(const QString &file, bool isCached, const QString &currentSha,
                              const QString &previousSha) const;
@@ -44,8 +60,26 @@ public:
    GitExecResult getFullFileDiff(const QString &currentSha, const QString &previousSha, const QString &file,
                                  bool isCached);
    GitExecResult getDiffFiles(const QString &sha, const QString &diffToSha);
+   // Same files as getDiffFiles, compared in-process over the object database with the rename and copy detection of
+   // diff-tree -C. Falls back to git when some object can't be read.
+   RevisionFiles getRevisionFiles(const QString &sha, const QString &diffToSha,
+                                  int similarity = GitRenameDetector::DEFAULT_SIMILARITY,
+                                  int renameLimit = GitRenameDetector::DEFAULT_RENAME_LIMIT);
+   // A null diffToId compares with the empty tree, as an empty diffToSha does
+   RevisionFiles getRevisionFiles(const ObjectId &id, const ObjectId &diffToId,
+                                  int similarity = GitRenameDetector::DEFAULT_SIMILARITY,
+                                  int renameLimit = GitRenameDetector::DEFAULT_RENAME_LIMIT);
+   // Loads the files of many commits in-process, or with a single git process if some can't be read. Each pair is the
+   // full SHA of a commit and the commit it's compared with. An empty second SHA compares the commit with its parents,
+   // or with the empty tree for roots, unlike getDiffFiles where it always means the empty tree.
+   QHash<QString, RevisionFiles> getCommitsFiles(const QVector<QPair<QString, QString>> &commits);
    GitExecResult getUntrackedFileDiff(const QString &file) const;
 
 private:
    QSharedPointer<GitBase> mGitBase;
+
+   QPair<QString, QString> getFullBranchNames(const QString &base, const QString &head);
+   GitExecResult historyByGit(const QString &file, int skip, int maxCount) const;
+   bool diffInProcess(const ObjectId &id, const QVector<ObjectId> &parents, int similarity, int renameLimit,
+                      RevisionFiles &files) const;
 };
@@ -0,0 +1,174 @@
+#include "GitMultiPackIndex.h"
+
+#include <QtEndian>
+
+#include <QLogger.h>
+
+#include <cstring>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr quint32 MIDX_SIGNATURE = 0x4d494458; // "MIDX"
+constexpr quint32 CHUNK_PACK_NAMES = 0x504e414d; // "PNAM"
+constexpr quint32 CHUNK_OID_FANOUT = 0x4f494446; // "OIDF"
+constexpr quint32 CHUNK_OID_LOOKUP = 0x4f49444c; // "OIDL"
+constexpr quint32 CHUNK_OBJECT_OFFSETS = 0x4f4f4646; // "OOFF"
+constexpr quint32 CHUNK_LARGE_OFFSETS = 0x4c4f4646; // "LOFF"
+constexpr quint32 LARGE_OFFSET = 0x80000000;
+constexpr int HEADER_SIZE = 12;
+constexpr int CHUNK_ENTRY_SIZE = 12;
+constexpr int FANOUT_SIZE = 256 * 4;
+
+quint32 readU32(const uchar *data)
+{
+   return qFromBigEndian<quint32>(data);
+}
+
+quint64 readU64(const uchar *data)
+{
+   return qFromBigEndian<quint64>(data);
+}
+}
+
+GitMultiPackIndex::GitMultiPackIndex(const QString &filePath)
+   : mFile(filePath)
+{
+}
+
+bool GitMultiPackIndex::load()
+{
+   if (!mFile.open(QIODevice::ReadOnly))
+      return false;
+
+   mSize = mFile.size();
+   mData = mSize >= HEADER_SIZE ? mFile.map(0, mSize) : nullptr;
+
+   if (!mData || readU32(mData) != MIDX_SIGNATURE || mData[4] != 1 || (mData[5] != 1 && mData[5] != 2))
+   {
+      QLog_Warning("Git", QString("Unsupported multi-pack-index {%1}").arg(filePath()));
+      return false;
+   }
+
+   mHashSize = mData[5] == 1 ? 20 : 32;
+
+   const auto chunkCount = static_cast<int>(mData[6]);
+   const auto packCount = readU32(mData + 8);
+
+   // Each chunk ends where the next one starts; the table has an extra entry marking the end of the last one
+   if (mData[7] != 0 || HEADER_SIZE + (chunkCount + 1) * CHUNK_ENTRY_SIZE > mSize)
+      return false;
+
+   const uchar *packNames = nullptr;
+   qint64 packNamesSize = 0;
+   qint64 oidsSize = 0;
+   qint64 offsetsSize = 0;
+   qint64 largeOffsetsSize = 0;
+
+   for (auto i = 0; i < chunkCount; ++i)
+   {
+      const auto entry = mData + HEADER_SIZE + i * CHUNK_ENTRY_SIZE;
+      const auto start = readU64(entry + 4);
+      const auto end = readU64(entry + CHUNK_ENTRY_SIZE + 4);
+
+      if (start > end || end > static_cast<quint64>(mSize))
+         return false;
+
+      const auto chunk = mData + start;
+      const auto chunkSize = static_cast<qint64>(end - start);
+
+      switch (readU32(entry))
+      {
+         case CHUNK_PACK_NAMES:
+            packNames = chunk;
+            packNamesSize = chunkSize;
+            break;
+         case CHUNK_OID_FANOUT:
+            mFanout = chunkSize >= FANOUT_SIZE ? chunk : nullptr;
+            break;
+         case CHUNK_OID_LOOKUP:
+            mOids = chunk;
+            oidsSize = chunkSize;
+            break;
+         case CHUNK_OBJECT_OFFSETS:
+            mOffsets = chunk;
+            offsetsSize = chunkSize;
+            break;
+         case CHUNK_LARGE_OFFSETS:
+            mLargeOffsets = chunk;
+            largeOffsetsSize = chunkSize;
+            break;
+         default:
+            break;
+      }
+   }
+
+   if (!packNames || !mFanout || !mOids || !mOffsets)
+      return false;
+
+   mObjectCount = readU32(mFanout + 255 * 4);
+   mLargeOffsetCount = static_cast<quint32>(largeOffsetsSize / 8);
+
+   if (oidsSize < static_cast<qint64>(mObjectCount) * mHashSize || offsetsSize < static_cast<qint64>(mObjectCount) * 8)
+      return false;
+
+   // NUL terminated names, padded with more NULs
+   for (qint64 pos = 0; pos < packNamesSize && static_cast<quint32>(mPackNames.count()) < packCount;)
+   {
+      const auto nameEnd = static_cast<const uchar *>(memchr(packNames + pos, '\0', packNamesSize - pos));
+
+      if (!nameEnd)
+         return false;
+
+      mPackNames.append(QString::fromUtf8(reinterpret_cast<const char *>(packNames + pos),
+                                          static_cast<int>(nameEnd - packNames - pos)));
+      pos = nameEnd - packNames + 1;
+   }
+
+   if (static_cast<quint32>(mPackNames.count()) != packCount)
+      return false;
+
+   QLog_Debug("Git", QString("Loaded multi-pack-index {%1} with {%2} packs").arg(filePath()).arg(packCount));
+
+   return true;
+}
+
+bool GitMultiPackIndex::find(const QByteArray &rawOid, quint32 &pack, quint64 &offset) const
+{
+   if (!mOids || rawOid.size() != mHashSize)
+      return false;
+
+   const auto firstByte = static_cast<uchar>(rawOid.at(0));
+   auto low = firstByte == 0 ? 0u : readU32(mFanout + (firstByte - 1) * 4);
+   auto high = qMin(readU32(mFanout + firstByte * 4), mObjectCount);
+
+   while (low < high)
+   {
+      const auto middle = low + (high - low) / 2;
+      const auto cmp = memcmp(mOids + static_cast<qint64>(middle) * mHashSize, rawOid.constData(), mHashSize);
+
+      if (cmp < 0)
+         low = middle + 1;
+      else if (cmp > 0)
+         high = middle;
+      else
+      {
+         const auto entry = mOffsets + static_cast<qint64>(middle) * 8;
+         const auto packOffset = readU32(entry + 4);
+
+         pack = readU32(entry);
+
+         if (!(packOffset & LARGE_OFFSET))
+            offset = packOffset;
+         else if (const auto largeIndex = packOffset & ~LARGE_OFFSET; mLargeOffsets && largeIndex < mLargeOffsetCount)
+            offset = readU64(mLargeOffsets + static_cast<qint64>(largeIndex) * 8);
+         else
+            return false;
+
+         return static_cast<int>(pack) < mPackNames.count();
+      }
+   }
+
+   return false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+// The multi-pack-index written by git multi-pack-index and git maintenance: one sorted table of the objects in many
+// packs, so a lookup is a single binary search instead of one per pack.
+class GitMultiPackIndex
+{
+public:
+   explicit GitMultiPackIndex(const QString &filePath);
+
+   bool load();
+   QString filePath() const { return mFile.fileName(); }
+   int hashSize() const { return mHashSize; }
+   quint32 objectCount() const { return mObjectCount; }
+   // Names of the .idx files of the covered packs, relative to the pack directory. Lookups refer to them by position.
+   QStringList packNames() const { return mPackNames; }
+
+   bool find(const QByteArray &rawOid, quint32 &pack, quint64 &offset) const;
+
+private:
+   QFile mFile;
+   const uchar *mData = nullptr;
+   qint64 mSize = 0;
+   int mHashSize = 20;
+   quint32 mObjectCount = 0;
+   QStringList mPackNames;
+   const uchar *mFanout = nullptr;
+   const uchar *mOids = nullptr;
+   const uchar *mOffsets = nullptr;
+   const uchar *mLargeOffsets = nullptr;
+   quint32 mLargeOffsetCount = 0;
+};
@@ -0,0 +1,135 @@
+#include "GitNetworkProcess.h"
+
+#include <QTimer>
+
+#include <QLogger.h>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr int POLL_INTERVAL = 1000;
+constexpr qint64 INACTIVITY_TIMEOUT = 300000;
+}
+
+GitNetworkProcess::GitNetworkProcess(const QString &workingDir)
+   : AGitProcess(workingDir)
+{
+   qRegisterMetaType<GitProgress>("GitProgress");
+
+   connect(this, &AGitProcess::readyReadStandardError, this, &GitNetworkProcess::onReadyStandardError,
+           Qt::DirectConnection);
+   connect(
+       this, &AGitProcess::readyReadStandardOutput, this, [this]() { mLastActivity.restart(); }, Qt::DirectConnection);
+}
+
+GitExecResult GitNetworkProcess::run(const QString &command)
+{
+   if (execute(command))
+   {
+      mLastActivity.start();
+
+      while (state() != QProcess::NotRunning && !waitForFinished(POLL_INTERVAL))
+      {
+         if (stopIfInactive())
+         {
+            waitForFinished();
+            break;
+         }
+      }
+   }
+
+   close();
+
+   return { !mRealError, mRunOutput };
+}
+
+bool GitNetworkProcess::runAsync(const QString &command)
+{
+   mAsync = true;
+
+   const auto started = execute(command);
+
+   if (started)
+   {
+      mLastActivity.start();
+
+      // The process reports its end as usual once killed, so a silent remote can't hold the caller forever
+      mWatchdog = new QTimer(this);
+      mWatchdog->setInterval(POLL_INTERVAL);
+      connect(mWatchdog, &QTimer::timeout, this, &GitNetworkProcess::stopIfInactive);
+      mWatchdog->start();
+   }
+
+   return started;
+}
+
+void GitNetworkProcess::cancel()
+{
+   if (state() != QProcess::NotRunning)
+   {
+      mCanceling = true;
+      kill();
+   }
+}
+
+bool GitNetworkProcess::stopIfInactive()
+{
+   if (mCanceling || !mLastActivity.hasExpired(INACTIVITY_TIMEOUT))
+      return false;
+
+   QLog_Warning("Git", QString("No output from {%1} in %2 seconds. Stopping it.")
+                           .arg(mCommand)
+                           .arg(INACTIVITY_TIMEOUT / 1000));
+   cancel();
+
+   return true;
+}
+
+void GitNetworkProcess::onReadyStandardError()
+{
+   mLastActivity.restart();
+
+   emitProgress(mParser.feed(readAllStandardError()));
+}
+
+void GitNetworkProcess::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+   QLog_Debug("Git", QString("Process {%1} finished.").arg(mCommand));
+
+   if (mWatchdog)
+      mWatchdog->stop();
+
+   emitProgress(mParser.feed(readAllStandardError()));
+   emitProgress(mParser.finish());
+
+   mErrorOutput = mParser.lines().join('\n');
+
+   // Fetch and push print the names of the refs they update on stderr, and a branch can be called "fix-error": only
+   // the exit code tells a failure apart
+   mRealError = exitStatus != QProcess::NormalExit || exitCode != 0 || mCanceling;
+
+   mRunOutput.append(QString::fromUtf8(readAllStandardOutput()));
+
+   // Pull prints the conflicts on stdout, so it's kept even when the command failed
+   if (mRealError && !mErrorOutput.isEmpty())
+      mRunOutput.prepend(QString("%1\n").arg(mErrorOutput));
+   else if (!mErrorOutput.isEmpty())
+      mRunOutput.append(mErrorOutput).append('\n');
+
+   if (mAsync)
+   {
+      emit signalFinished({ !mRealError, mRunOutput });
+
+      deleteLater();
+   }
+}
+
+void GitNetworkProcess::emitProgress(const QVector<GitProgress> &updates)
+{
+   if (!mCanceling)
+   {
+      for (const auto &progress : updates)
+         emit signalProgress(progress);
+   }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <AGitProcess.h>
+#include <GitProgressParser.h>
+
+#include <QElapsedTimer>
+
+class QTimer;
+
+// Runs the commands that talk to a remote: fetch, push, pull... They can take minutes, so instead of a fixed timeout
+// the process is stopped only when it stays silent for too long. The progress on stderr is parsed as it arrives.
+class GitNetworkProcess : public AGitProcess
+{
+   Q_OBJECT
+
+signals:
+   void signalProgress(GitProgress progress);
+   // Only emitted for the processes started with runAsync
+   void signalFinished(GitExecResult result);
+
+public:
+   explicit GitNetworkProcess(const QString &workingDir);
+
+   // Blocks until the command finishes
+   GitExecResult run(const QString &command) override;
+   // Returns as soon as the command started. The process deletes itself after emitting signalFinished.
+   bool runAsync(const QString &command);
+   void cancel();
+
+   // The stderr lines that weren't progress
+   QStringList messages() const { return mParser.lines(); }
+
+private:
+   GitProgressParser mParser;
+   QElapsedTimer mLastActivity;
+   // Checks the inactivity of the processes started with runAsync
+   QTimer *mWatchdog = nullptr;
+   bool mAsync = false;
+
+   void onReadyStandardError();
+   void onFinished(int exitCode, QProcess::ExitStatus exitStatus) override;
+   void emitProgress(const QVector<GitProgress> &updates);
+   bool stopIfInactive();
+};
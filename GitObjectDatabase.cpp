@@ -0,0 +1,741 @@
+#include "GitObjectDatabase.h"
+
+#include <GitBitmapIndex.h>
+#include <GitMultiPackIndex.h>
+#include <GitPackFile.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <QLogger.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace QLogger;
+
+namespace
+{
+// Compressed bytes read from disk at a time. It's the only buffer that doesn't depend on what the caller requests.
+constexpr int INPUT_CHUNK_SIZE = 16 * 1024;
+
+// "commit 18446744073709551615\0" plus some margin
+constexpr int MAX_HEADER_SIZE = 64;
+
+// Git itself refuses to write longer chains. Anything above this is a corrupt pack pointing to itself.
+constexpr int MAX_DELTA_CHAIN_LENGTH = 10000;
+
+constexpr ObjectId EMPTY_TREE_SHA256
+    = ObjectId::fromHex("6ef19b41225c5369f1c104d45d8d85efa9b057b53b14b4b9b939dd74decc5321", 64);
+
+QByteArray headerValue(const QByteArray &line, const char *key)
+{
+   const auto keyLength = static_cast<int>(qstrlen(key));
+
+   return line.size() > keyLength && line.startsWith(key) && line.at(keyLength) == ' ' ? line.mid(keyLength + 1)
+                                                                                         : QByteArray();
+}
+
+// Walks the "key value" lines of a commit or a tag until the blank line that starts the message
+template<typename Callback>
+QString parseHeaders(const QByteArray &data, Callback onLine)
+{
+   auto pos = 0;
+
+   while (pos < data.size())
+   {
+      auto end = data.indexOf('\n', pos);
+
+      if (end < 0)
+         end = data.size();
+
+      if (end == pos)
+         return QString::fromUtf8(data.mid(end + 1));
+
+      onLine(data.mid(pos, end - pos));
+
+      pos = end + 1;
+   }
+
+   return QString();
+}
+}
+
+struct GitObjectDatabase::ObjectStream::Inflater
+{
+   QFile file;
+   z_stream stream {};
+   QByteArray input;
+   bool initialized = false;
+   bool finished = false;
+
+   explicit Inflater(const QString &filePath)
+      : file(filePath)
+   {
+   }
+
+   ~Inflater()
+   {
+      if (initialized)
+         inflateEnd(&stream);
+   }
+};
+
+GitObjectDatabase::ObjectStream::ObjectStream(const QString &filePath)
+   : mInflater(QSharedPointer<Inflater>::create(filePath))
+{
+   if (!mInflater->file.open(QIODevice::ReadOnly) || inflateInit(&mInflater->stream) != Z_OK)
+      return;
+
+   mInflater->initialized = true;
+   mInflater->input.resize(INPUT_CHUNK_SIZE);
+
+   QByteArray header(MAX_HEADER_SIZE, '\0');
+   const auto headerSize = inflate(header.data(), header.size());
+
+   header.truncate(headerSize < 0 ? 0 : static_cast<int>(headerSize));
+
+   const auto end = header.indexOf('\0');
+   const auto space = header.indexOf(' ');
+   auto validSize = false;
+   const auto size = end > space && space > 0 ? header.mid(space + 1, end - space - 1).toLongLong(&validSize) : 0;
+   const auto type = space > 0 ? typeFromName(header.left(space)) : ObjectType::Invalid;
+
+   if (type == ObjectType::Invalid || !validSize || size < header.size() - end - 1)
+   {
+      QLog_Warning("Git", QString("Corrupt loose object {%1}").arg(filePath));
+      return;
+   }
+
+   mType = type;
+   mSize = size;
+   mPending = header.mid(end + 1);
+}
+
+GitObjectDatabase::ObjectStream::~ObjectStream() = default;
+
+QByteArray GitObjectDatabase::ObjectStream::read(qint64 maxSize)
+{
+   if (!isValid() || atEnd() || maxSize <= 0)
+      return QByteArray();
+
+   const auto remaining = qMin(maxSize, mSize - mDelivered);
+   const auto wanted = static_cast<int>(qMin<qint64>(remaining, std::numeric_limits<int>::max()));
+   auto data = mPending.left(wanted);
+
+   mPending.remove(0, data.size());
+
+   if (const auto filled = data.size(); filled < wanted)
+   {
+      data.resize(wanted);
+
+      if (inflate(data.data() + filled, wanted - filled) != wanted - filled)
+      {
+         QLog_Warning("Git", QString("Corrupt loose object {%1}").arg(mInflater->file.fileName()));
+
+         mType = ObjectType::Invalid;
+         return QByteArray();
+      }
+   }
+
+   mDelivered += data.size();
+
+   return data;
+}
+
+qint64 GitObjectDatabase::ObjectStream::inflate(char *output, qint64 maxSize)
+{
+   auto &stream = mInflater->stream;
+   qint64 produced = 0;
+
+   while (produced < maxSize && !mInflater->finished)
+   {
+      if (stream.avail_in == 0)
+      {
+         const auto bytesRead = mInflater->file.read(mInflater->input.data(), mInflater->input.size());
+
+         if (bytesRead <= 0)
+            return -1;
+
+         stream.next_in = reinterpret_cast<Bytef *>(mInflater->input.data());
+         stream.avail_in = static_cast<uInt>(bytesRead);
+      }
+
+      const auto chunk = static_cast<uInt>(qMin<qint64>(maxSize - produced, std::numeric_limits<uInt>::max()));
+
+      stream.next_out = reinterpret_cast<Bytef *>(output + produced);
+      stream.avail_out = chunk;
+
+      const auto ret = ::inflate(&stream, Z_NO_FLUSH);
+
+      if (ret != Z_OK && ret != Z_STREAM_END)
+         return -1;
+
+      produced += chunk - stream.avail_out;
+      mInflater->finished = ret == Z_STREAM_END;
+   }
+
+   return produced;
+}
+
+GitObjectDatabase::GitObjectDatabase(const QString &objectsDir, int deltaBaseCacheSize)
+   : mDeltaBaseCache(deltaBaseCacheSize)
+   , mTreeCache(TREE_CACHE_SIZE)
+{
+   mObjectDirs.append(objectsDir);
+
+   QFile alternates(QString("%1/info/alternates").arg(objectsDir));
+
+   if (alternates.open(QIODevice::ReadOnly))
+   {
+      const auto lines = QString::fromUtf8(alternates.readAll()).split('\n', Qt::SkipEmptyParts);
+
+      for (const auto &line : lines)
+      {
+         const auto path = line.trimmed();
+
+         if (!path.isEmpty() && !path.startsWith('#'))
+         {
+            mObjectDirs.append(
+                QDir::cleanPath(QDir::isAbsolutePath(path) ? path : QString("%1/%2").arg(objectsDir, path)));
+         }
+      }
+   }
+}
+
+GitObjectDatabase::~GitObjectDatabase() = default;
+
+bool GitObjectDatabase::contains(const QString &sha) const
+{
+   return contains(ObjectId::fromString(sha));
+}
+
+bool GitObjectDatabase::contains(const ObjectId &id) const
+{
+   const auto rawOid = id.toRaw();
+
+   return !id.isNull()
+       && (isPacked(rawOid) || !findLooseObject(id.toString()).isEmpty() || (reloadPacks() && isPacked(rawOid)));
+}
+
+QSharedPointer<GitObjectDatabase::ObjectStream> GitObjectDatabase::openStream(const QString &sha) const
+{
+   const auto filePath = findLooseObject(sha);
+
+   if (filePath.isEmpty())
+      return QSharedPointer<ObjectStream>();
+
+   const auto stream = QSharedPointer<ObjectStream>::create(filePath);
+
+   return stream->isValid() ? stream : QSharedPointer<ObjectStream>();
+}
+
+GitObjectDatabase::Object GitObjectDatabase::read(const QString &sha) const
+{
+   return read(ObjectId::fromString(sha));
+}
+
+GitObjectDatabase::Object GitObjectDatabase::read(const ObjectId &id) const
+{
+   if (id.isNull())
+      return Object();
+
+   const auto rawOid = id.toRaw();
+   auto object = readPacked(rawOid, 0);
+
+   if (!object.isValid())
+      object = readLoose(id.toString());
+
+   if (!object.isValid() && reloadPacks())
+      object = readPacked(rawOid, 0);
+
+   return object;
+}
+
+bool GitObjectDatabase::readTree(const ObjectId &id, QVector<TreeEntry> &entries) const
+{
+   {
+      QMutexLocker lock(&mMutex);
+
+      if (const auto cached = mTreeCache.object(id))
+      {
+         entries = *cached;
+         return true;
+      }
+   }
+
+   const auto object = read(id);
+
+   if (object.type != ObjectType::Tree)
+   {
+      entries.clear();
+      return id == INIT_OID || id == EMPTY_TREE_SHA256;
+   }
+
+   entries = parseTree(object.data, id.size());
+
+   if (entries.isEmpty() && !object.data.isEmpty())
+      return false;
+
+   QMutexLocker lock(&mMutex);
+   mTreeCache.insert(id, new QVector<TreeEntry>(entries), qMax(1, static_cast<int>(object.data.size())));
+
+   return true;
+}
+
+GitObjectDatabase::ObjectType GitObjectDatabase::typeFromName(const QByteArray &name)
+{
+   if (name == "commit")
+      return ObjectType::Commit;
+   else if (name == "tree")
+      return ObjectType::Tree;
+   else if (name == "blob")
+      return ObjectType::Blob;
+   else if (name == "tag")
+      return ObjectType::Tag;
+
+   return ObjectType::Invalid;
+}
+
+GitObjectDatabase::Commit GitObjectDatabase::parseCommit(const QByteArray &data)
+{
+   Commit commit;
+
+   commit.message = parseHeaders(data, [&commit](const QByteArray &line) {
+      if (const auto tree = headerValue(line, "tree"); !tree.isEmpty())
+         commit.tree = ObjectId::fromHex(tree.constData(), static_cast<int>(tree.size()));
+      else if (const auto parent = headerValue(line, "parent"); !parent.isEmpty())
+         commit.parents.append(ObjectId::fromHex(parent.constData(), static_cast<int>(parent.size())));
+      else if (const auto author = headerValue(line, "author"); !author.isEmpty())
+         commit.author = QString::fromUtf8(author);
+      else if (const auto committer = headerValue(line, "committer"); !committer.isEmpty())
+         commit.committer = QString::fromUtf8(committer);
+   });
+
+   return commit;
+}
+
+QVector<GitObjectDatabase::TreeEntry> GitObjectDatabase::parseTree(const QByteArray &data, int hashSize)
+{
+   QVector<TreeEntry> entries;
+   auto pos = 0;
+
+   while (pos < data.size())
+   {
+      const auto space = data.indexOf(' ', pos);
+      const auto nameEnd = space < 0 ? -1 : data.indexOf('\0', space);
+      auto validMode = false;
+      const auto mode = space > pos ? data.mid(pos, space - pos).toUInt(&validMode, 8) : 0;
+
+      if (nameEnd < 0 || !validMode || nameEnd + 1 + hashSize > data.size())
+      {
+         QLog_Warning("Git", QString("Corrupt tree object"));
+         return QVector<TreeEntry>();
+      }
+
+      entries.append(TreeEntry {
+          mode, QString::fromUtf8(data.mid(space + 1, nameEnd - space - 1)),
+          ObjectId::fromRaw(reinterpret_cast<const unsigned char *>(data.constData()) + nameEnd + 1, hashSize) });
+
+      pos = nameEnd + 1 + hashSize;
+   }
+
+   return entries;
+}
+
+GitObjectDatabase::Tag GitObjectDatabase::parseTag(const QByteArray &data)
+{
+   Tag tag;
+
+   tag.message = parseHeaders(data, [&tag](const QByteArray &line) {
+      if (const auto object = headerValue(line, "object"); !object.isEmpty())
+         tag.object = ObjectId::fromHex(object.constData(), static_cast<int>(object.size()));
+      else if (const auto type = headerValue(line, "type"); !type.isEmpty())
+         tag.type = typeFromName(type);
+      else if (const auto name = headerValue(line, "tag"); !name.isEmpty())
+         tag.name = QString::fromUtf8(name);
+      else if (const auto tagger = headerValue(line, "tagger"); !tagger.isEmpty())
+         tag.tagger = QString::fromUtf8(tagger);
+   });
+
+   return tag;
+}
+
+QString GitObjectDatabase::findLooseObject(const QString &sha) const
+{
+   if (sha.length() != 40 && sha.length() != 64)
+      return QString();
+
+   const auto name = sha.toLower();
+
+   for (const auto &dir : mObjectDirs)
+   {
+      const auto filePath = QString("%1/%2/%3").arg(dir, name.left(2), name.mid(2));
+
+      if (QFile::exists(filePath))
+         return filePath;
+   }
+
+   return QString();
+}
+
+GitObjectDatabase::Object GitObjectDatabase::readLoose(const QString &sha) const
+{
+   Object object;
+
+   if (const auto stream = openStream(sha))
+   {
+      object.data = stream->read(stream->size());
+      object.type = stream->atEnd() ? stream->type() : ObjectType::Invalid;
+   }
+
+   return object;
+}
+
+QSharedPointer<GitBitmapIndex> GitObjectDatabase::bitmapIndex() const
+{
+   loadPacks();
+
+   {
+      QMutexLocker lock(&mMutex);
+
+      if (mBitmapIndexSearched)
+         return mBitmapIndex;
+   }
+
+   // Git writes a single bitmap, for the pack of a full repack. Bitmaps of alternates and of multi-pack-indexes are
+   // not used.
+   const QDir packDir(QString("%1/pack").arg(mObjectDirs.constFirst()));
+   const auto bitmapNames = packDir.entryList({ "pack-*.bitmap" }, QDir::Files);
+   QSharedPointer<GitBitmapIndex> found;
+
+   for (const auto &bitmapName : bitmapNames)
+   {
+      const auto pack = openPack(packDir.filePath(bitmapName.left(bitmapName.length() - 7) + ".idx"));
+
+      if (!pack)
+         continue;
+
+      if (const auto bitmapIndex = QSharedPointer<GitBitmapIndex>::create(pack); bitmapIndex->load())
+      {
+         found = bitmapIndex;
+         break;
+      }
+   }
+
+   QMutexLocker lock(&mMutex);
+
+   if (!mBitmapIndexSearched)
+   {
+      mBitmapIndex = found;
+      mBitmapIndexSearched = true;
+   }
+
+   return mBitmapIndex;
+}
+
+void GitObjectDatabase::loadPacks() const
+{
+   {
+      QMutexLocker lock(&mMutex);
+
+      if (!mPackDirStamps.isEmpty())
+         return;
+   }
+
+   reloadPacks();
+}
+
+bool GitObjectDatabase::reloadPacks() const
+{
+   QVector<qint64> stamps;
+
+   for (const auto &dir : mObjectDirs)
+   {
+      const QFileInfo packDir(QString("%1/pack").arg(dir));
+      stamps.append(packDir.exists() ? packDir.lastModified().toMSecsSinceEpoch() : -1);
+   }
+
+   QMutexLocker lock(&mMutex);
+
+   if (stamps == mPackDirStamps)
+      return false;
+
+   const auto loadedPack = [this](const QString &indexPath) {
+      const auto iter = std::find_if(mPacks.cbegin(), mPacks.cend(), [&indexPath](const auto &pack) {
+         return pack->indexPath() == indexPath;
+      });
+
+      return iter != mPacks.cend() ? *iter : QSharedPointer<GitPackFile>();
+   };
+
+   QVector<QSharedPointer<GitPackFile>> packs;
+   QVector<MultiPackIndex> multiPackIndexes;
+   QVector<QSharedPointer<GitPackFile>> uncoveredPacks;
+
+   for (const auto &dir : mObjectDirs)
+   {
+      const QDir packDir(QString("%1/pack").arg(dir));
+      QSet<QString> coveredPaths;
+
+      // The packs a multi-pack-index covers are opened when the first object is found in them
+      if (const auto filePath = packDir.filePath("multi-pack-index"); QFileInfo::exists(filePath))
+      {
+         MultiPackIndex multiPackIndex;
+         multiPackIndex.index = QSharedPointer<GitMultiPackIndex>::create(filePath);
+
+         if (multiPackIndex.index->load())
+         {
+            const auto packNames = multiPackIndex.index->packNames();
+
+            for (const auto &packName : packNames)
+            {
+               const auto indexPath = packDir.filePath(packName);
+               const auto pack = loadedPack(indexPath);
+
+               coveredPaths.insert(indexPath);
+               multiPackIndex.indexPaths.append(indexPath);
+               multiPackIndex.packs.append(pack);
+
+               if (pack)
+                  packs.append(pack);
+            }
+
+            multiPackIndexes.append(multiPackIndex);
+         }
+      }
+
+      // A multi-pack-index doesn't cover the packs written after it. Newest packs first, as git does: recent objects
+      // are the ones asked the most.
+      const auto indexes = packDir.entryList({ "*.idx" }, QDir::Files, QDir::Time);
+
+      for (const auto &index : indexes)
+      {
+         const auto indexPath = packDir.filePath(index);
+
+         if (coveredPaths.contains(indexPath))
+            continue;
+
+         auto pack = loadedPack(indexPath);
+
+         if (!pack)
+         {
+            pack = QSharedPointer<GitPackFile>::create(indexPath);
+
+            if (!pack->load())
+               continue;
+         }
+
+         packs.append(pack);
+         uncoveredPacks.append(pack);
+      }
+   }
+
+   QLog_Debug("Git", QString("Loaded {%1} packs and {%2} multi-pack-indexes from {%3}")
+                         .arg(uncoveredPacks.count())
+                         .arg(multiPackIndexes.count())
+                         .arg(mObjectDirs.constFirst()));
+
+   // The cache is keyed by the address of the pack, which a new pack could reuse
+   if (std::any_of(mPacks.cbegin(), mPacks.cend(), [&packs](const auto &pack) { return !packs.contains(pack); }))
+      mDeltaBaseCache.clear();
+
+   mBitmapIndex.reset();
+   mBitmapIndexSearched = false;
+   mMissingPacks.clear();
+
+   mPacks = packs;
+   mMultiPackIndexes = multiPackIndexes;
+   mUncoveredPacks = uncoveredPacks;
+   mPackDirStamps = stamps;
+
+   return true;
+}
+
+QSharedPointer<GitPackFile> GitObjectDatabase::openPack(const QString &indexPath) const
+{
+   QMutexLocker lock(&mMutex);
+
+   if (const auto iter = std::find_if(mPacks.cbegin(), mPacks.cend(),
+                                      [&indexPath](const auto &pack) { return pack->indexPath() == indexPath; });
+       iter != mPacks.cend())
+   {
+      return *iter;
+   }
+
+   if (mMissingPacks.contains(indexPath))
+      return QSharedPointer<GitPackFile>();
+
+   const auto pack = QSharedPointer<GitPackFile>::create(indexPath);
+
+   if (!pack->load())
+   {
+      QLog_Warning("Git", QString("Unable to open the pack {%1}").arg(indexPath));
+      mMissingPacks.insert(indexPath);
+      return QSharedPointer<GitPackFile>();
+   }
+
+   mPacks.append(pack);
+
+   for (auto &multiPackIndex : mMultiPackIndexes)
+   {
+      if (const auto position = multiPackIndex.indexPaths.indexOf(indexPath); position != -1)
+         multiPackIndex.packs[position] = pack;
+   }
+
+   return pack;
+}
+
+bool GitObjectDatabase::findPacked(const QByteArray &rawOid, QSharedPointer<GitPackFile> &pack,
+                                   quint64 &offset) const
+{
+   loadPacks();
+
+   QVector<MultiPackIndex> multiPackIndexes;
+   QVector<QSharedPointer<GitPackFile>> uncoveredPacks;
+
+   {
+      QMutexLocker lock(&mMutex);
+      multiPackIndexes = mMultiPackIndexes;
+      uncoveredPacks = mUncoveredPacks;
+   }
+
+   for (const auto &multiPackIndex : std::as_const(multiPackIndexes))
+   {
+      quint32 position = 0;
+
+      if (!multiPackIndex.index->find(rawOid, position, offset))
+         continue;
+
+      const auto index = static_cast<int>(position);
+
+      pack = multiPackIndex.packs.at(index);
+
+      if (!pack)
+         pack = openPack(multiPackIndex.indexPaths.at(index));
+
+      if (pack)
+         return true;
+   }
+
+   for (const auto &candidate : std::as_const(uncoveredPacks))
+   {
+      if (offset = candidate->findOffset(rawOid); offset != GitPackFile::NO_OFFSET)
+      {
+         pack = candidate;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool GitObjectDatabase::isPacked(const QByteArray &rawOid) const
+{
+   QSharedPointer<GitPackFile> pack;
+   quint64 offset = 0;
+
+   return findPacked(rawOid, pack, offset);
+}
+
+GitObjectDatabase::Object GitObjectDatabase::readPacked(const QByteArray &rawOid, int depth) const
+{
+   QSharedPointer<GitPackFile> pack;
+   quint64 offset = 0;
+
+   return findPacked(rawOid, pack, offset) ? readPacked(pack, offset, depth) : Object();
+}
+
+GitObjectDatabase::Object GitObjectDatabase::readPacked(const QSharedPointer<GitPackFile> &pack, quint64 offset,
+                                                        int depth) const
+{
+   // Walks down the chain until a full object (or a cached base) is found, then applies the deltas back up
+   QVector<QPair<PackLocation, QByteArray>> deltas;
+   auto baseLocation = qMakePair(static_cast<const GitPackFile *>(pack.data()), offset);
+   auto cacheable = true;
+   Object base;
+
+   while (!base.isValid())
+   {
+      {
+         QMutexLocker lock(&mMutex);
+
+         if (const auto cached = mDeltaBaseCache.object(baseLocation))
+         {
+            base = *cached;
+            break;
+         }
+      }
+
+      GitPackFile::Entry entry;
+
+      if (depth + deltas.count() > MAX_DELTA_CHAIN_LENGTH || !pack->readEntry(baseLocation.second, entry))
+      {
+         QLog_Warning("Git", QString("Corrupt object at offset {%1} in {%2}").arg(offset).arg(pack->indexPath()));
+         return Object();
+      }
+
+      QByteArray data;
+
+      if (!pack->inflate(entry, data))
+         return Object();
+
+      if (entry.type == GitPackFile::OFS_DELTA)
+      {
+         deltas.append(qMakePair(baseLocation, data));
+         baseLocation.second = entry.baseOffset;
+      }
+      else if (entry.type == GitPackFile::REF_DELTA)
+      {
+         deltas.append(qMakePair(baseLocation, data));
+
+         if (const auto baseOffset = pack->findOffset(entry.baseId); baseOffset != GitPackFile::NO_OFFSET)
+            baseLocation.second = baseOffset;
+         else
+         {
+            // Only thin packs point to bases outside themselves, and git completes them when it stores them
+            base = readPacked(entry.baseId, depth + deltas.count());
+
+            if (!base.isValid())
+               base = readLoose(QString::fromLatin1(entry.baseId.toHex()));
+
+            if (!base.isValid())
+               return Object();
+
+            cacheable = false;
+         }
+      }
+      else
+      {
+         base.type = static_cast<ObjectType>(entry.type);
+         base.data = data;
+      }
+   }
+
+   for (auto i = deltas.count() - 1; i >= 0; --i)
+   {
+      if (cacheable)
+      {
+         QMutexLocker lock(&mMutex);
+         mDeltaBaseCache.insert(baseLocation, new Object(base), static_cast<int>(base.data.size()));
+      }
+
+      Object target;
+      target.type = base.type;
+
+      if (!GitPackFile::applyDelta(base.data, deltas.at(i).second, target.data))
+      {
+         QLog_Warning("Git", QString("Corrupt delta at offset {%1} in {%2}").arg(offset).arg(pack->indexPath()));
+         return Object();
+      }
+
+      base = target;
+      baseLocation = deltas.at(i).first;
+      cacheable = true;
+   }
+
+   return base;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <ObjectId.h>
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class GitBitmapIndex;
+class GitMultiPackIndex;
+class GitPackFile;
+
+// In-process access to the object database (objects/ and its alternates) without spawning git.
+class GitObjectDatabase
+{
+public:
+   // Same default as git's core.deltaBaseCacheLimit
+   static constexpr int DEFAULT_DELTA_BASE_CACHE_SIZE = 96 * 1024 * 1024;
+   // Parsed trees, counted by the size of their objects
+   static constexpr int TREE_CACHE_SIZE = 32 * 1024 * 1024;
+
+   // Same values git uses in the pack files
+   enum class ObjectType
+   {
+      Invalid = 0,
+      Commit = 1,
+      Tree = 2,
+      Blob = 3,
+      Tag = 4
+   };
+
+   struct Object
+   {
+      ObjectType type = ObjectType::Invalid;
+      QByteArray data;
+
+      bool isValid() const { return type != ObjectType::Invalid; }
+   };
+
+   struct Commit
+   {
+      ObjectId tree;
+      QVector<ObjectId> parents;
+      QString author;
+      QString committer;
+      QString message;
+
+      bool isValid() const { return !tree.isNull(); }
+   };
+
+   struct TreeEntry
+   {
+      quint32 mode = 0;
+      QString name;
+      ObjectId id;
+
+      bool isTree() const { return mode == 040000; }
+      bool isSubmodule() const { return mode == 0160000; }
+   };
+
+   struct Tag
+   {
+      ObjectId object;
+      ObjectType type = ObjectType::Invalid;
+      QString name;
+      QString tagger;
+      QString message;
+
+      bool isValid() const { return !object.isNull(); }
+   };
+
+   // Inflates an object in pieces so big blobs never need to be held in memory at once.
+   class ObjectStream
+   {
+   public:
+      explicit ObjectStream(const QString &filePath);
+      ~ObjectStream();
+
+      bool isValid() const { return mType != ObjectType::Invalid; }
+      ObjectType type() const { return mType; }
+      qint64 size() const { return mSize; }
+      bool atEnd() const { return mDelivered == mSize; }
+
+      // Returns at most maxSize bytes of the object content. An empty array before atEnd() means the object is corrupt.
+      QByteArray read(qint64 maxSize);
+
+   private:
+      struct Inflater;
+
+      QSharedPointer<Inflater> mInflater;
+      ObjectType mType = ObjectType::Invalid;
+      qint64 mSize = 0;
+      qint64 mDelivered = 0;
+      QByteArray mPending;
+
+      qint64 inflate(char *output, qint64 maxSize);
+   };
+
+   explicit GitObjectDatabase(const QString &objectsDir, int deltaBaseCacheSize = DEFAULT_DELTA_BASE_CACHE_SIZE);
+   ~GitObjectDatabase();
+
+   // The packs are scanned again when an object isn't found, so objects from a fetch or a gc are seen.
+   bool contains(const QString &sha) const;
+   bool contains(const ObjectId &id) const;
+
+   // Only loose objects can be streamed: null when the object is packed or doesn't exist.
+   QSharedPointer<ObjectStream> openStream(const QString &sha) const;
+   Object read(const QString &sha) const;
+   Object read(const ObjectId &id) const;
+   // Parsed trees are cached by id, since neighbour commits share most of them. The empty tree doesn't need to exist.
+   bool readTree(const ObjectId &id, QVector<TreeEntry> &entries) const;
+
+   // The reachability bitmaps of the main pack, or null when the repository wasn't repacked with them.
+   QSharedPointer<GitBitmapIndex> bitmapIndex() const;
+
+   static ObjectType typeFromName(const QByteArray &name);
+   static Commit parseCommit(const QByteArray &data);
+   static QVector<TreeEntry> parseTree(const QByteArray &data, int hashSize = 20);
+   static Tag parseTag(const QByteArray &data);
+
+private:
+   using PackLocation = QPair<const GitPackFile *, quint64>;
+
+   // A multi-pack-index and the packs it covers, by the position it gives them. A pack is null until an object is
+   // found in it.
+   struct MultiPackIndex
+   {
+      QSharedPointer<GitMultiPackIndex> index;
+      QStringList indexPaths;
+      QVector<QSharedPointer<GitPackFile>> packs;
+   };
+
+   QStringList mObjectDirs;
+   mutable QMutex mMutex;
+   // Every pack opened so far
+   mutable QVector<QSharedPointer<GitPackFile>> mPacks;
+   mutable QVector<MultiPackIndex> mMultiPackIndexes;
+   // Packs that no multi-pack-index covers, searched one by one
+   mutable QVector<QSharedPointer<GitPackFile>> mUncoveredPacks;
+   mutable QSet<QString> mMissingPacks;
+   mutable QVector<qint64> mPackDirStamps;
+   mutable QCache<PackLocation, Object> mDeltaBaseCache;
+   mutable QCache<ObjectId, QVector<TreeEntry>> mTreeCache;
+   mutable QSharedPointer<GitBitmapIndex> mBitmapIndex;
+   mutable bool mBitmapIndexSearched = false;
+
+   QString findLooseObject(const QString &sha) const;
+   Object readLoose(const QString &sha) const;
+   void loadPacks() const;
+   bool reloadPacks() const;
+   QSharedPointer<GitPackFile> openPack(const QString &indexPath) const;
+   bool findPacked(const QByteArray &rawOid, QSharedPointer<GitPackFile> &pack, quint64 &offset) const;
+   bool isPacked(const QByteArray &rawOid) const;
+   Object readPacked(const QByteArray &rawOid, int depth) const;
+   Object readPacked(const QSharedPointer<GitPackFile> &pack, quint64 offset, int depth) const;
+};
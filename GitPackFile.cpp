@@ -0,0 +1,340 @@
+#include "GitPackFile.h"
+
+#include <QtEndian>
+
+#include <QLogger.h>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <limits>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr quint32 INDEX_SIGNATURE = 0xff744f63; // "\377tOc"
+constexpr quint32 PACK_SIGNATURE = 0x5041434b; // "PACK"
+constexpr quint32 LARGE_OFFSET = 0x80000000;
+constexpr int FANOUT_SIZE = 256 * 4;
+
+quint32 readU32(const uchar *data)
+{
+   return qFromBigEndian<quint32>(data);
+}
+
+quint64 readU64(const uchar *data)
+{
+   return qFromBigEndian<quint64>(data);
+}
+
+// Little-endian base-128 sizes used in the delta headers
+bool readDeltaSize(const uchar *&data, const uchar *end, qint64 &size)
+{
+   size = 0;
+
+   for (auto shift = 0; data < end && shift < 64; shift += 7)
+   {
+      const auto byte = *data++;
+      size |= static_cast<qint64>(byte & 0x7f) << shift;
+
+      if (!(byte & 0x80))
+         return true;
+   }
+
+   return false;
+}
+}
+
+GitPackFile::GitPackFile(const QString &indexPath)
+   : mIndexFile(indexPath)
+{
+   mPackFile.setFileName(indexPath.left(indexPath.length() - 4) + ".pack");
+}
+
+bool GitPackFile::load()
+{
+   if (!mIndexFile.open(QIODevice::ReadOnly) || !mPackFile.open(QIODevice::ReadOnly))
+      return false;
+
+   const auto indexSize = mIndexFile.size();
+   mPackSize = mPackFile.size();
+
+   if (indexSize < 8 + FANOUT_SIZE + 2 * 20 || mPackSize < 12 + 20)
+      return false;
+
+   mIndex = mIndexFile.map(0, indexSize);
+   mPack = mPackFile.map(0, mPackSize);
+
+   if (!mIndex || !mPack)
+      return false;
+
+   if (readU32(mIndex) != INDEX_SIGNATURE || readU32(mIndex + 4) != 2 || readU32(mPack) != PACK_SIGNATURE)
+   {
+      QLog_Warning("Git", QString("Unsupported pack index {%1}").arg(indexPath()));
+      return false;
+   }
+
+   mObjectCount = readU32(mIndex + 8 + 255 * 4);
+
+   // The index doesn't store the hash function, but it ends with a copy of the pack checksum
+   const auto checksumMatches = [this, indexSize](int hashSize) {
+      return indexSize >= 8 + FANOUT_SIZE + 2 * hashSize && mPackSize >= 12 + hashSize
+          && memcmp(mPack + mPackSize - hashSize, mIndex + indexSize - 2 * hashSize, hashSize) == 0;
+   };
+
+   if (checksumMatches(20))
+      mHashSize = 20;
+   else if (checksumMatches(32))
+      mHashSize = 32;
+   else
+      return false;
+
+   const auto tablesSize = static_cast<qint64>(mObjectCount) * (mHashSize + 4 + 4);
+   const auto largeOffsetsSize = indexSize - 8 - FANOUT_SIZE - tablesSize - 2 * mHashSize;
+
+   if (readU32(mPack + 8) != mObjectCount || largeOffsetsSize < 0 || largeOffsetsSize % 8 != 0)
+      return false;
+
+   mOids = mIndex + 8 + FANOUT_SIZE;
+   mOffsets = mOids + static_cast<qint64>(mObjectCount) * (mHashSize + 4);
+   mLargeOffsets = mOffsets + static_cast<qint64>(mObjectCount) * 4;
+   mLargeOffsetCount = static_cast<quint32>(largeOffsetsSize / 8);
+
+   return true;
+}
+
+quint32 GitPackFile::findPosition(const ObjectId &id) const
+{
+   if (!mOids || id.size() != mHashSize)
+      return NO_POSITION;
+
+   const auto firstByte = id.data()[0];
+   auto low = firstByte == 0 ? 0u : readU32(mIndex + 8 + (firstByte - 1) * 4);
+   auto high = readU32(mIndex + 8 + firstByte * 4);
+
+   while (low < high)
+   {
+      const auto middle = low + (high - low) / 2;
+      const auto cmp = memcmp(mOids + static_cast<qint64>(middle) * mHashSize, id.data(), mHashSize);
+
+      if (cmp == 0)
+         return middle;
+
+      if (cmp < 0)
+         low = middle + 1;
+      else
+         high = middle;
+   }
+
+   return NO_POSITION;
+}
+
+quint64 GitPackFile::offsetAt(quint32 position) const
+{
+   if (!mOffsets || position >= mObjectCount)
+      return NO_OFFSET;
+
+   const auto offset = readU32(mOffsets + static_cast<qint64>(position) * 4);
+
+   if (!(offset & LARGE_OFFSET))
+      return offset;
+
+   const auto largeIndex = offset & ~LARGE_OFFSET;
+
+   return largeIndex < mLargeOffsetCount ? readU64(mLargeOffsets + static_cast<qint64>(largeIndex) * 8) : NO_OFFSET;
+}
+
+quint32 GitPackFile::findPosition(const QByteArray &rawOid) const
+{
+   return findPosition(ObjectId::fromRaw(rawOid));
+}
+
+quint64 GitPackFile::findOffset(const QByteArray &rawOid) const
+{
+   return offsetAt(findPosition(rawOid));
+}
+
+QByteArray GitPackFile::checksum() const
+{
+   return mPack ? QByteArray(reinterpret_cast<const char *>(mPack + mPackSize - mHashSize), mHashSize) : QByteArray();
+}
+
+bool GitPackFile::readEntry(quint64 offset, Entry &entry) const
+{
+   const auto end = mPack + mPackSize - mHashSize;
+
+   if (!mPack || offset < 12 || offset >= static_cast<quint64>(mPackSize - mHashSize))
+      return false;
+
+   auto data = mPack + offset;
+   auto byte = *data++;
+
+   entry = Entry();
+   entry.type = (byte >> 4) & 0x7;
+   entry.size = byte & 0x0f;
+
+   for (auto shift = 4; byte & 0x80; shift += 7)
+   {
+      if (data >= end || shift > 57)
+         return false;
+
+      byte = *data++;
+      entry.size |= static_cast<qint64>(byte & 0x7f) << shift;
+   }
+
+   if (entry.type == OFS_DELTA)
+   {
+      if (data >= end)
+         return false;
+
+      byte = *data++;
+      quint64 distance = byte & 0x7f;
+
+      while (byte & 0x80)
+      {
+         if (data >= end || distance > (std::numeric_limits<quint64>::max() >> 8))
+            return false;
+
+         byte = *data++;
+         distance = ((distance + 1) << 7) | (byte & 0x7f);
+      }
+
+      if (distance == 0 || distance > offset)
+         return false;
+
+      entry.baseOffset = offset - distance;
+   }
+   else if (entry.type == REF_DELTA)
+   {
+      if (data + mHashSize > end)
+         return false;
+
+      entry.baseId = QByteArray(reinterpret_cast<const char *>(data), mHashSize);
+      data += mHashSize;
+   }
+   else if (entry.type < 1 || entry.type > 4)
+      return false;
+
+   entry.dataOffset = static_cast<quint64>(data - mPack);
+
+   return true;
+}
+
+bool GitPackFile::inflate(const Entry &entry, QByteArray &output) const
+{
+   if (entry.size > std::numeric_limits<int>::max() || entry.dataOffset >= static_cast<quint64>(mPackSize))
+      return false;
+
+   output = QByteArray(static_cast<int>(entry.size), Qt::Uninitialized);
+   z_stream stream {};
+
+   if (inflateInit(&stream) != Z_OK)
+      return false;
+
+   // The compressed size isn't stored, so zlib gets everything up to the end of the pack
+   const auto available = static_cast<quint64>(mPackSize) - entry.dataOffset;
+   stream.next_in = const_cast<Bytef *>(mPack + entry.dataOffset);
+   stream.avail_in = static_cast<uInt>(qMin<quint64>(available, std::numeric_limits<uInt>::max()));
+   stream.next_out = reinterpret_cast<Bytef *>(output.data());
+   stream.avail_out = static_cast<uInt>(output.size());
+
+   auto ret = ::inflate(&stream, Z_FINISH);
+
+   // An empty object still has an empty zlib stream behind it
+   if (ret == Z_BUF_ERROR && output.isEmpty())
+   {
+      Bytef dummy;
+      stream.next_out = &dummy;
+      stream.avail_out = 1;
+      ret = ::inflate(&stream, Z_FINISH);
+   }
+
+   const auto complete = ret == Z_STREAM_END && stream.total_out == static_cast<uLong>(entry.size);
+
+   inflateEnd(&stream);
+
+   if (!complete)
+   {
+      QLog_Warning("Git", QString("Corrupt entry at offset {%1} in {%2}").arg(entry.dataOffset).arg(indexPath()));
+      return false;
+   }
+
+   return true;
+}
+
+bool GitPackFile::applyDelta(const QByteArray &base, const QByteArray &delta, QByteArray &result)
+{
+   auto data = reinterpret_cast<const uchar *>(delta.constData());
+   const auto end = data + delta.size();
+   qint64 baseSize = 0;
+   qint64 resultSize = 0;
+
+   if (!readDeltaSize(data, end, baseSize) || !readDeltaSize(data, end, resultSize) || baseSize != base.size()
+       || resultSize > std::numeric_limits<int>::max())
+   {
+      return false;
+   }
+
+   result = QByteArray(static_cast<int>(resultSize), Qt::Uninitialized);
+   auto output = result.data();
+   const auto outputEnd = output + result.size();
+
+   while (data < end)
+   {
+      const auto command = *data++;
+
+      if (command & 0x80)
+      {
+         quint64 copyOffset = 0;
+         quint64 copySize = 0;
+
+         for (auto i = 0; i < 4; ++i)
+         {
+            if (command & (1 << i))
+            {
+               if (data >= end)
+                  return false;
+
+               copyOffset |= static_cast<quint64>(*data++) << (8 * i);
+            }
+         }
+
+         for (auto i = 0; i < 3; ++i)
+         {
+            if (command & (0x10 << i))
+            {
+               if (data >= end)
+                  return false;
+
+               copySize |= static_cast<quint64>(*data++) << (8 * i);
+            }
+         }
+
+         if (copySize == 0)
+            copySize = 0x10000;
+
+         if (copyOffset + copySize > static_cast<quint64>(base.size())
+             || copySize > static_cast<quint64>(outputEnd - output))
+         {
+            return false;
+         }
+
+         memcpy(output, base.constData() + copyOffset, copySize);
+         output += copySize;
+      }
+      else if (command != 0)
+      {
+         if (command > end - data || command > outputEnd - output)
+            return false;
+
+         memcpy(output, data, command);
+         output += command;
+         data += command;
+      }
+      else
+         return false;
+   }
+
+   return output == outputEnd;
+}
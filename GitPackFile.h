@@ -0,0 +1,83 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <ObjectId.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// A pack file and its version 2 index, both memory mapped. Entries are addressed by their offset in the pack; delta
+// chains are resolved by the caller, which knows about the other packs and the loose objects.
+class GitPackFile
+{
+public:
+   static constexpr quint64 NO_OFFSET = ~quint64(0);
+   static constexpr quint32 NO_POSITION = 0xffffffff;
+   static constexpr int OFS_DELTA = 6;
+   static constexpr int REF_DELTA = 7;
+
+   struct Entry
+   {
+      int type = 0;
+      qint64 size = 0;
+      quint64 dataOffset = 0;
+      quint64 baseOffset = NO_OFFSET;
+      QByteArray baseId;
+   };
+
+   explicit GitPackFile(const QString &indexPath);
+
+   bool load();
+   QString indexPath() const { return mIndexFile.fileName(); }
+   int hashSize() const { return mHashSize; }
+   quint32 objectCount() const { return mObjectCount; }
+
+   // The position of an object in the index, which is sorted by object id
+   quint32 findPosition(const ObjectId &id) const;
+   quint32 findPosition(const QByteArray &rawOid) const;
+   quint64 offsetAt(quint32 position) const;
+   quint64 findOffset(const QByteArray &rawOid) const;
+   // The trailing hash of the pack. Files that belong to the pack, as its bitmap, repeat it.
+   QByteArray checksum() const;
+   bool readEntry(quint64 offset, Entry &entry) const;
+   // Inflates the data of an entry: the object content, or the delta instructions for OFS_DELTA and REF_DELTA.
+   bool inflate(const Entry &entry, QByteArray &output) const;
+
+   static bool applyDelta(const QByteArray &base, const QByteArray &delta, QByteArray &result);
+
+private:
+   QFile mIndexFile;
+   QFile mPackFile;
+   const uchar *mIndex = nullptr;
+   const uchar *mPack = nullptr;
+   qint64 mPackSize = 0;
+   quint32 mObjectCount = 0;
+   int mHashSize = 20;
+   const uchar *mOids = nullptr;
+   const uchar *mOffsets = nullptr;
+   const uchar *mLargeOffsets = nullptr;
+   quint32 mLargeOffsetCount = 0;
+};
@@ -0,0 +1,134 @@
+#include "GitProgressParser.h"
+
+#include <QRegularExpression>
+
+namespace
+{
+// "Receiving objects:  45% (450/1000), 1.20 MiB | 2.40 MiB/s" or "remote: Enumerating objects: 6, done."
+const QRegularExpression PROGRESS_LINE(
+    "^(remote: )?([^:]+):\\s+(?:(\\d+)%\\s+\\((\\d+)/(\\d+)\\)(.*)|(\\d+)(?:,(.*))?)$");
+// Git prints sizes in binary units with two decimals, always with a dot
+const QRegularExpression TRANSFER(
+    "^,\\s*([\\d.]+) (bytes|KiB|MiB|GiB|TiB)(?:\\s*\\|\\s*([\\d.]+) (bytes|KiB|MiB|GiB|TiB)/s)?");
+
+const struct
+{
+   const char *description;
+   GitProgress::Phase phase;
+} PHASES[] = { { "Enumerating objects", GitProgress::Phase::Enumerating },
+               { "Counting objects", GitProgress::Phase::Counting },
+               { "Compressing objects", GitProgress::Phase::Compressing },
+               { "Receiving objects", GitProgress::Phase::Receiving },
+               { "Resolving deltas", GitProgress::Phase::Resolving },
+               { "Writing objects", GitProgress::Phase::Writing },
+               { "Unpacking objects", GitProgress::Phase::Unpacking },
+               { "Updating files", GitProgress::Phase::CheckingOut },
+               { "Checking out files", GitProgress::Phase::CheckingOut } };
+
+double toBytes(const QString &value, const QString &unit)
+{
+   const auto units = QStringList { "bytes", "KiB", "MiB", "GiB", "TiB" };
+   auto bytes = value.toDouble();
+
+   for (auto i = units.indexOf(unit); i > 0; --i)
+      bytes *= 1024.0;
+
+   return bytes;
+}
+}
+
+GitProgress::Phase GitProgress::phaseFromDescription(const QString &description)
+{
+   for (const auto &entry : PHASES)
+   {
+      if (description == entry.description)
+         return entry.phase;
+   }
+
+   return Phase::Other;
+}
+
+QVector<GitProgress> GitProgressParser::feed(const QByteArray &chunk)
+{
+   QVector<GitProgress> updates;
+
+   mPending.append(chunk);
+
+   auto start = 0;
+
+   for (auto i = 0; i < mPending.size(); ++i)
+   {
+      if (mPending.at(i) == '\r' || mPending.at(i) == '\n')
+      {
+         parseLine(mPending.mid(start, i - start), updates);
+         start = i + 1;
+      }
+   }
+
+   mPending.remove(0, start);
+
+   return updates;
+}
+
+QVector<GitProgress> GitProgressParser::finish()
+{
+   QVector<GitProgress> updates;
+
+   parseLine(mPending, updates);
+   mPending.clear();
+
+   return updates;
+}
+
+void GitProgressParser::parseLine(const QByteArray &rawLine, QVector<GitProgress> &updates)
+{
+   auto line = QString::fromUtf8(rawLine);
+
+   // The remote pads its lines with spaces to clear what the previous update left on the terminal. The leading ones
+   // are kept: the flag of a fast-forward in the ref lines of fetch is a space.
+   while (!line.isEmpty() && line.back().isSpace())
+      line.chop(1);
+
+   if (line.isEmpty())
+      return;
+
+   const auto match = PROGRESS_LINE.match(line);
+
+   if (!match.hasMatch())
+   {
+      mLines.append(line);
+      return;
+   }
+
+   GitProgress progress;
+   progress.remote = match.capturedLength(1) > 0;
+   progress.description = match.captured(2).trimmed();
+   progress.phase = GitProgress::phaseFromDescription(progress.description);
+
+   QString rest;
+
+   if (match.capturedLength(3) > 0)
+   {
+      progress.percent = match.captured(3).toInt();
+      progress.current = match.captured(4).toLongLong();
+      progress.total = match.captured(5).toLongLong();
+      rest = match.captured(6);
+   }
+   else
+   {
+      progress.current = match.captured(7).toLongLong();
+      rest = QString(",%1").arg(match.captured(8));
+   }
+
+   progress.done = rest.contains("done");
+
+   if (const auto transfer = TRANSFER.match(rest); transfer.hasMatch())
+   {
+      progress.bytes = static_cast<qint64>(toBytes(transfer.captured(1), transfer.captured(2)));
+
+      if (transfer.capturedLength(3) > 0)
+         progress.bytesPerSecond = toBytes(transfer.captured(3), transfer.captured(4));
+   }
+
+   updates.append(progress);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+// One update of the progress git prints on stderr with --progress
+struct GitProgress
+{
+   enum class Phase
+   {
+      Other,
+      Enumerating,
+      Counting,
+      Compressing,
+      Receiving,
+      Resolving,
+      Writing,
+      Unpacking,
+      CheckingOut
+   };
+
+   Phase phase = Phase::Other;
+   // As git prints it: "Receiving objects", "Resolving deltas"...
+   QString description;
+   int percent = -1;
+   qint64 current = -1;
+   qint64 total = -1;
+   // Only while objects are transferred: received when fetching, written when pushing
+   qint64 bytes = -1;
+   double bytesPerSecond = -1.0;
+   bool done = false;
+   // Printed by the other end, with the "remote: " prefix
+   bool remote = false;
+
+   double mebibytesPerSecond() const { return bytesPerSecond < 0 ? -1.0 : bytesPerSecond / (1024.0 * 1024.0); }
+   static Phase phaseFromDescription(const QString &description);
+};
+
+Q_DECLARE_METATYPE(GitProgress)
+
+using GitProgressCallback = std::function<void(const GitProgress &progress)>;
+
+// Splits the stderr of a network command into progress updates and the rest of the messages. Git rewrites the progress
+// line in place with '\r', and a read can end anywhere in a line, so the unfinished tail is kept for the next chunk.
+class GitProgressParser
+{
+public:
+   QVector<GitProgress> feed(const QByteArray &chunk);
+   // Parses what is left after the last line break. To call once the process closed stderr.
+   QVector<GitProgress> finish();
+
+   // Everything that wasn't progress: errors, hints, the ref updates of fetch and push...
+   QStringList lines() const { return mLines; }
+
+private:
+   QByteArray mPending;
+   QStringList mLines;
+
+   void parseLine(const QByteArray &rawLine, QVector<GitProgress> &updates);
+};
@@ -0,0 +1,333 @@
+#include "GitRefDatabase.h"
+
+#include <FileStamp.h>
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QtEndian>
+
+#include <QLogger.h>
+
+#include <cstring>
+
+using namespace QLogger;
+
+namespace
+{
+// Same limit git uses when following symbolic refs
+constexpr int MAX_SYMREF_DEPTH = 5;
+
+bool isHex(const QByteArray &value)
+{
+   if (value.size() != 40 && value.size() != 64)
+      return false;
+
+   for (const auto c : value)
+   {
+      if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+         return false;
+   }
+
+   return true;
+}
+
+// HEAD, ORIG_HEAD, MERGE_HEAD, FETCH_HEAD...
+bool isPseudoRef(const QString &name)
+{
+   static const QRegularExpression pseudoRef("^[A-Z_]+$");
+
+   return pseudoRef.match(name).hasMatch();
+}
+
+int compareNames(const uchar *data, int length, const QByteArray &name)
+{
+   const auto cmp = memcmp(data, name.constData(), static_cast<size_t>(qMin(length, static_cast<int>(name.size()))));
+
+   return cmp != 0 ? cmp : length - static_cast<int>(name.size());
+}
+}
+
+struct GitRefDatabase::PackedRefs
+{
+   QFile file;
+   const uchar *data = nullptr;
+   qint64 size = 0;
+   qint64 stamp = -1;
+   bool sorted = false;
+
+   bool find(const QByteArray &name, QByteArray &sha, QByteArray &peeledSha) const;
+
+private:
+   qint64 lineEnd(qint64 pos) const
+   {
+      const auto end = static_cast<const uchar *>(memchr(data + pos, '\n', static_cast<size_t>(size - pos)));
+      return end ? end - data : size;
+   }
+
+   qint64 lineStart(qint64 pos, qint64 lowerBound) const
+   {
+      while (pos > lowerBound && data[pos - 1] != '\n')
+         --pos;
+
+      return pos;
+   }
+
+   // Reads the record at pos. Returns the position of the next record, after the peeled line if there is one.
+   qint64 readRecord(qint64 pos, QByteArray &recordName, QByteArray &sha, QByteArray &peeledSha) const
+   {
+      const auto end = lineEnd(pos);
+      const auto space = static_cast<const uchar *>(memchr(data + pos, ' ', static_cast<size_t>(end - pos)));
+      auto next = qMin(end + 1, size);
+
+      recordName.clear();
+      peeledSha.clear();
+
+      if (space)
+      {
+         sha = QByteArray(reinterpret_cast<const char *>(data + pos), static_cast<int>(space - data - pos));
+         recordName = QByteArray(reinterpret_cast<const char *>(space + 1), static_cast<int>(data + end - space - 1));
+      }
+
+      if (next < size && data[next] == '^')
+      {
+         const auto peeledEnd = lineEnd(next);
+         peeledSha
+             = QByteArray(reinterpret_cast<const char *>(data + next + 1), static_cast<int>(peeledEnd - next - 1));
+         next = qMin(peeledEnd + 1, size);
+      }
+
+      return next;
+   }
+};
+
+bool GitRefDatabase::PackedRefs::find(const QByteArray &name, QByteArray &sha, QByteArray &peeledSha) const
+{
+   if (!data)
+      return false;
+
+   auto low = data[0] == '#' ? qMin(lineEnd(0) + 1, size) : qint64(0);
+   auto high = size;
+   QByteArray recordName;
+
+   if (!sorted)
+   {
+      while (low < high)
+      {
+         low = readRecord(low, recordName, sha, peeledSha);
+
+         if (recordName == name)
+            return true;
+      }
+
+      return false;
+   }
+
+   while (low < high)
+   {
+      auto record = lineStart(low + (high - low) / 2, low);
+
+      // Landing on a peeled line means the record starts on the line before
+      if (data[record] == '^' && record > low)
+         record = lineStart(record - 1, low);
+
+      const auto next = readRecord(record, recordName, sha, peeledSha);
+      const auto cmp = compareNames(reinterpret_cast<const uchar *>(recordName.constData()),
+                                    static_cast<int>(recordName.size()), name);
+
+      if (cmp == 0)
+         return true;
+
+      if (cmp < 0)
+         low = next;
+      else
+         high = record;
+   }
+
+   return false;
+}
+
+GitRefDatabase::GitRefDatabase(const QString &gitDir, const QString &commonDir)
+   : mGitDir(gitDir)
+   , mCommonDir(commonDir)
+{
+}
+
+GitRefDatabase::~GitRefDatabase() = default;
+
+bool GitRefDatabase::isSupported() const
+{
+   return !QFileInfo::exists(QString("%1/reftable").arg(mCommonDir));
+}
+
+GitRefDatabase::Ref GitRefDatabase::resolve(const QString &fullName) const
+{
+   Ref ref;
+   auto name = fullName;
+
+   for (auto depth = 0; depth <= MAX_SYMREF_DEPTH; ++depth)
+   {
+      if (name.isEmpty() || name.contains("..") || name.startsWith('/') || name.contains('\\'))
+         return Ref();
+
+      auto perWorktree = false;
+      QFile file(refPath(name, perWorktree));
+      QByteArray content;
+
+      if (file.open(QIODevice::ReadOnly))
+         content = file.readLine().trimmed();
+
+      if (content.startsWith("ref:"))
+      {
+         name = QString::fromUtf8(content.mid(4).trimmed());
+
+         if (ref.symbolicTarget.isEmpty())
+            ref.symbolicTarget = name;
+
+         continue;
+      }
+
+      ref.name = name;
+
+      // FETCH_HEAD lines carry the branch description after the SHA
+      const auto sha = content.left(content.indexOf('\t') < 0 ? content.size() : content.indexOf('\t')).trimmed();
+
+      if (isHex(sha))
+      {
+         ref.sha = QString::fromLatin1(sha);
+         return ref;
+      }
+
+      QByteArray packedSha;
+      QByteArray peeledSha;
+
+      if (const auto packed = perWorktree ? QSharedPointer<PackedRefs>() : packedRefs();
+          packed && packed->find(name.toUtf8(), packedSha, peeledSha) && isHex(packedSha))
+      {
+         ref.sha = QString::fromLatin1(packedSha);
+         ref.peeledSha = isHex(peeledSha) ? QString::fromLatin1(peeledSha) : QString();
+         return ref;
+      }
+
+      return ref;
+   }
+
+   QLog_Warning("Git", QString("Too many levels of symbolic refs resolving {%1}").arg(fullName));
+
+   return Ref();
+}
+
+GitRefDatabase::Ref GitRefDatabase::resolveShortName(const QString &name) const
+{
+   if (isHex(name.toLatin1()))
+   {
+      Ref ref;
+      ref.sha = name;
+
+      return ref;
+   }
+
+   if (isPseudoRef(name) || name.startsWith("refs/") || name.startsWith("main-worktree/")
+       || name.startsWith("worktrees/"))
+   {
+      if (const auto ref = resolve(name); ref.isValid())
+         return ref;
+   }
+
+   for (const auto &pattern : { "refs/%1", "refs/tags/%1", "refs/heads/%1", "refs/remotes/%1", "refs/remotes/%1/HEAD" })
+   {
+      if (const auto ref = resolve(QString(pattern).arg(name)); ref.isValid())
+         return ref;
+   }
+
+   return Ref();
+}
+
+QByteArray GitRefDatabase::signature() const
+{
+   QStringList paths { QString("%1/HEAD").arg(mGitDir), QString("%1/packed-refs").arg(mCommonDir) };
+   QStringList refDirs { QString("%1/refs").arg(mCommonDir) };
+
+   if (mGitDir != mCommonDir)
+      refDirs.append(QString("%1/refs").arg(mGitDir));
+
+   for (const auto &refDir : std::as_const(refDirs))
+   {
+      paths.append(refDir);
+
+      QDirIterator iter(refDir, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden, QDirIterator::Subdirectories);
+
+      while (iter.hasNext())
+         paths.append(iter.next());
+   }
+
+   QByteArray signature;
+   signature.reserve(paths.count() * 8);
+
+   for (const auto &path : std::as_const(paths))
+   {
+      const auto stamp = qToBigEndian(fileStamp(path));
+      signature.append(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+   }
+
+   return signature;
+}
+
+QString GitRefDatabase::refPath(const QString &name, bool &perWorktree) const
+{
+   if (name.startsWith("main-worktree/"))
+   {
+      perWorktree = true;
+      return QString("%1/%2").arg(mCommonDir, name.mid(14));
+   }
+
+   if (name.startsWith("worktrees/"))
+   {
+      perWorktree = true;
+      const auto separator = name.indexOf('/', 10);
+
+      return separator < 0 ? QString()
+                           : QString("%1/worktrees/%2/%3").arg(mCommonDir, name.mid(10, separator - 10),
+                                                                name.mid(separator + 1));
+   }
+
+   perWorktree = isPseudoRef(name) || name.startsWith("refs/bisect/") || name.startsWith("refs/worktree/")
+       || name.startsWith("refs/rewritten/");
+
+   return QString("%1/%2").arg(perWorktree ? mGitDir : mCommonDir, name);
+}
+
+QSharedPointer<GitRefDatabase::PackedRefs> GitRefDatabase::packedRefs() const
+{
+   const auto filePath = QString("%1/packed-refs").arg(mCommonDir);
+   const auto stamp = fileStamp(filePath);
+
+   QMutexLocker lock(&mMutex);
+
+   if (mPackedRefs && mPackedRefs->stamp == stamp)
+      return mPackedRefs;
+
+   // git replaces packed-refs with a rename, so the file mapped by a previous snapshot stays valid for its readers
+   auto packedRefs = QSharedPointer<PackedRefs>::create();
+   packedRefs->stamp = stamp;
+   packedRefs->file.setFileName(filePath);
+
+   if (packedRefs->file.open(QIODevice::ReadOnly) && packedRefs->file.size() > 0)
+   {
+      packedRefs->size = packedRefs->file.size();
+      packedRefs->data = packedRefs->file.map(0, packedRefs->size);
+
+      if (packedRefs->data && packedRefs->data[0] == '#')
+      {
+         const auto header = QByteArray(reinterpret_cast<const char *>(packedRefs->data),
+                                        static_cast<int>(qMin<qint64>(packedRefs->size, 256)));
+         packedRefs->sorted = header.left(header.indexOf('\n')).contains(" sorted");
+      }
+   }
+
+   mPackedRefs = packedRefs;
+
+   return mPackedRefs;
+}
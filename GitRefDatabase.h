@@ -0,0 +1,73 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+// Resolves refs by reading HEAD, the loose refs and packed-refs directly. Refs that belong to the worktree (HEAD,
+// pseudo-refs, refs/bisect, refs/worktree, refs/rewritten) are read from its git dir, the rest from the common dir.
+class GitRefDatabase
+{
+public:
+   struct Ref
+   {
+      QString name;
+      QString sha;
+      // The object an annotated tag points to, when packed-refs stores it
+      QString peeledSha;
+      // First symbolic target followed, such as refs/heads/master for HEAD
+      QString symbolicTarget;
+
+      bool isValid() const { return !sha.isEmpty(); }
+   };
+
+   GitRefDatabase(const QString &gitDir, const QString &commonDir);
+   ~GitRefDatabase();
+
+   // False for repositories storing their refs in reftable: they have to be asked to git.
+   bool isSupported() const;
+
+   // Takes a full ref name (HEAD, refs/heads/master) and follows the symbolic refs.
+   Ref resolve(const QString &fullName) const;
+   // Expands the name the same way rev-parse does: refs/, refs/tags/, refs/heads/, refs/remotes/ and the remote HEAD.
+   // A full SHA is returned as it is.
+   Ref resolveShortName(const QString &name) const;
+
+   // Stamps of HEAD, packed-refs and every directory under refs/. Loose refs are written by renaming a lock file
+   // over them, which touches their directory, so any change to the refs gives a different signature.
+   QByteArray signature() const;
+
+private:
+   struct PackedRefs;
+
+   QString mGitDir;
+   QString mCommonDir;
+   mutable QMutex mMutex;
+   mutable QSharedPointer<PackedRefs> mPackedRefs;
+
+   QString refPath(const QString &name, bool &perWorktree) const;
+   QSharedPointer<PackedRefs> packedRefs() const;
+};
@@ -0,0 +1,91 @@
+#include "GitRefSnapshot.h"
+
+#include <GitBase.h>
+
+#include <QLogger.h>
+
+using namespace QLogger;
+
+GitRefSnapshot::GitRefSnapshot(const QByteArray &signature,
+                               const QSharedPointer<const GitConfigDatabase::Snapshot> &config)
+   : mSignature(signature)
+   , mConfig(config)
+{
+}
+
+bool GitRefSnapshot::load(const GitBase &git)
+{
+   // Not built with arg(): %09 would be taken as a placeholder. The subject goes last, as it may hold tabs.
+   const auto cmd = QString("git for-each-ref --format=%(refname)%09%(objectname)%09%(*objectname)%09%(upstream)"
+                            "%09%(upstream:track,nobracket)%09%(creatordate:unix)%09%(contents:subject)");
+
+   QLog_Trace("Git", QString("Listing the refs: {%1}").arg(cmd));
+
+   // Computing the ahead/behind of thousands of branches can take longer than the timeout of run()
+   const auto ret = git.runNetwork(cmd);
+
+   if (!ret.success)
+   {
+      QLog_Warning("Git", QString("Unable to list the refs: %1").arg(ret.output));
+      return false;
+   }
+
+   const auto lines = ret.output.split('\n', Qt::SkipEmptyParts);
+
+   mRefs.reserve(lines.count());
+
+   for (const auto &line : lines)
+   {
+      const auto fields = line.split('\t');
+
+      if (fields.count() < 7)
+         continue;
+
+      Ref ref;
+      ref.name = intern(fields.at(0));
+      ref.target = ObjectId::fromString(fields.at(1));
+      ref.peeled = ObjectId::fromString(fields.at(2));
+      ref.upstream = fields.at(3).isEmpty() ? -1 : intern(fields.at(3));
+      ref.date = fields.at(5).toLongLong();
+      ref.subject = intern(line.section('\t', 6));
+
+      // "ahead 2, behind 3", only one of them, nothing when in sync or "gone"
+      const auto &track = fields.at(4);
+      ref.upstreamGone = track == QString("gone");
+
+      const auto counts = track.split(", ", Qt::SkipEmptyParts);
+
+      for (const auto &count : counts)
+      {
+         if (count.startsWith("ahead "))
+            ref.ahead = count.mid(6).toInt();
+         else if (count.startsWith("behind "))
+            ref.behind = count.mid(7).toInt();
+      }
+
+      mRefByName.insert(ref.name, mRefs.count());
+      mRefs.append(ref);
+   }
+
+   QLog_Debug("Git", QString("Listed {%1} refs with {%2} distinct strings").arg(mRefs.count()).arg(mStrings.count()));
+
+   return true;
+}
+
+int GitRefSnapshot::indexOf(const QString &name) const
+{
+   const auto id = mStringIds.value(name, -1);
+
+   return id < 0 ? -1 : mRefByName.value(id, -1);
+}
+
+int GitRefSnapshot::intern(const QString &value)
+{
+   if (const auto iter = mStringIds.constFind(value); iter != mStringIds.cend())
+      return iter.value();
+
+   mStrings.append(value);
+   mStringIds.insert(value, mStrings.count() - 1);
+
+   return mStrings.count() - 1;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <GitConfigDatabase.h>
+#include <ObjectId.h>
+
+#include <QByteArray>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+class GitBase;
+
+// Every ref of the repository as listed by one for-each-ref: target, peeled target, upstream with ahead/behind and
+// the date and subject of the tip. Strings are interned, so refs sharing an upstream or a tip share the text too.
+class GitRefSnapshot
+{
+public:
+   struct Ref
+   {
+      // Ids of interned strings, -1 when there is none
+      int name = -1;
+      int upstream = -1;
+      int subject = -1;
+      ObjectId target;
+      // The object an annotated tag points to
+      ObjectId peeled;
+      qint32 ahead = 0;
+      qint32 behind = 0;
+      bool upstreamGone = false;
+      // Committer date of the tip, or the tagger date of an annotated tag, in seconds since the epoch
+      qint64 date = 0;
+   };
+
+   // The signature of the refs on disk and the config the upstreams come from, to tell when it is out of date
+   GitRefSnapshot(const QByteArray &signature, const QSharedPointer<const GitConfigDatabase::Snapshot> &config);
+
+   bool load(const GitBase &git);
+
+   QByteArray signature() const { return mSignature; }
+   QSharedPointer<const GitConfigDatabase::Snapshot> config() const { return mConfig; }
+
+   const QVector<Ref> &refs() const { return mRefs; }
+   // Position of a full ref name in refs(), or -1
+   int indexOf(const QString &name) const;
+   QString string(int id) const { return id < 0 ? QString() : mStrings.at(id); }
+
+private:
+   QByteArray mSignature;
+   QSharedPointer<const GitConfigDatabase::Snapshot> mConfig;
+   QVector<Ref> mRefs;
+   QStringList mStrings;
+   QHash<QString, int> mStringIds;
+   // Ref position by the id of its name
+   QHash<int, int> mRefByName;
+
+   int intern(const QString &value);
+};
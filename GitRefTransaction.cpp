@@ -0,0 +1,45 @@
+#include "GitRefTransaction.h"
+
+#include <GitBase.h>
+
+#include <QLogger.h>
+
+using namespace QLogger;
+
+GitRefTransaction::GitRefTransaction(const QSharedPointer<GitBase> &gitBase)
+   : mGitBase(gitBase)
+{
+}
+
+void GitRefTransaction::create(const QString &ref, const QString &newSha)
+{
+   mInput.append("create " + ref.toUtf8() + '\0' + newSha.toLatin1() + '\0');
+   ++mCount;
+}
+
+void GitRefTransaction::update(const QString &ref, const QString &newSha, const QString &oldSha)
+{
+   mInput.append("update " + ref.toUtf8() + '\0' + newSha.toLatin1() + '\0' + oldSha.toLatin1() + '\0');
+   ++mCount;
+}
+
+void GitRefTransaction::remove(const QString &ref, const QString &oldSha)
+{
+   mInput.append("delete " + ref.toUtf8() + '\0' + oldSha.toLatin1() + '\0');
+   ++mCount;
+}
+
+GitExecResult GitRefTransaction::commit()
+{
+   if (isEmpty())
+      return GitExecResult(true, QString());
+
+   QLog_Debug("Git", QString("Applying {%1} ref changes in one transaction").arg(mCount));
+
+   const auto ret = mGitBase->run("git update-ref --stdin -z", mInput);
+
+   mInput.clear();
+   mCount = 0;
+
+   return ret;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <GitExecResult.h>
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+
+class GitBase;
+
+// A batch of ref changes applied by a single git update-ref --stdin: either all of them happen or none, and
+// packed-refs is rewritten once for the whole batch. The commands are sent with -z: every argument ends with a NUL, the
+// optional ones too when they are empty.
+class GitRefTransaction
+{
+public:
+   explicit GitRefTransaction(const QSharedPointer<GitBase> &gitBase);
+
+   // Refs are full names (refs/heads/master). An empty old SHA skips the check of the current value.
+   void create(const QString &ref, const QString &newSha);
+   void update(const QString &ref, const QString &newSha, const QString &oldSha = QString());
+   void remove(const QString &ref, const QString &oldSha = QString());
+
+   int count() const { return mCount; }
+   bool isEmpty() const { return mCount == 0; }
+
+   // Applies the changes and empties the transaction
+   GitExecResult commit();
+
+private:
+   QSharedPointer<GitBase> mGitBase;
+   QByteArray mInput;
+   int mCount = 0;
+};
@@ -13,7 +13,7 @@ GitRemote::GitRemote(const QSharedPointer<GitBase> &gitBase)
 {
 }
 
-GitExecResult GitRemote::pushBranch(const QString &branchName, bool force)
+GitExecResult GitRemote::pushBranch(const QString &branchName, bool force, const GitProgressCallback &onProgress)
 {
    QLog_Debug("Git", QString("Executing push"));
 
@@ -21,34 +21,39 @@ GitExecResult GitRemote::pushBranch(const QString &branchName, bool force)
    const auto ret = gitConfig->getRemoteForBranch(branchName);
    const auto remote = ret.success && !ret.output.isEmpty() ? ret.output : QString("origin");
 
-   return mGitBase->run(QString("git push %1 %2 %3").arg(remote, branchName, force ? QString("--force") : QString()));
+   return mGitBase->runNetwork(
+       QString("git push --progress %1 %2 %3").arg(remote, branchName, force ? QString("--force") : QString()),
+       onProgress);
 }
 
-GitExecResult GitRemote::push(bool force)
+GitExecResult GitRemote::push(bool force, const GitProgressCallback &onProgress)
 {
    QLog_Debug("Git", QString("Executing push"));
 
-   const auto ret = mGitBase->run(QString("git push ").append(force ? QString("--force") : QString()));
+   const auto cmd = QString("git push --progress ").append(force ? QString("--force") : QString());
+   const auto ret = mGitBase->runNetwork(cmd, onProgress);
 
    return ret;
 }
 
-GitExecResult GitRemote::pushCommit(const QString &sha, const QString &remoteBranch)
+GitExecResult GitRemote::pushCommit(const QString &sha, const QString &remoteBranch,
+                                    const GitProgressCallback &onProgress)
 {
    QLog_Debug("Git", QString("Executing pushCommit"));
 
    QScopedPointer<GitConfig> gitConfig(new GitConfig(mGitBase));
    const auto remote = gitConfig->getRemoteForBranch(remoteBranch);
 
-   return mGitBase->run(QString("git push %1 %2:refs/heads/%3")
-                            .arg(remote.success ? remote.output : QString("origin"), sha, remoteBranch));
+   return mGitBase->runNetwork(QString("git push --progress %1 %2:refs/heads/%3")
+                                   .arg(remote.success ? remote.output : QString("origin"), sha, remoteBranch),
+                               onProgress);
 }
 
-GitExecResult GitRemote::pull(bool updateSubmodulesOnPull)
+GitExecResult GitRemote::pull(bool updateSubmodulesOnPull, const GitProgressCallback &onProgress)
 {
    QLog_Debug("Git", QString("Executing pull"));
 
-   auto ret = mGitBase->run("git pull");
+   auto ret = mGitBase->runNetwork("git pull --progress", onProgress);
 
    if (ret.success && updateSubmodulesOnPull)
    {
@@ -66,18 +71,18 @@ GitExecResult GitRemote::pull(bool updateSubmodulesOnPull)
    return ret;
 }
 
-bool GitRemote::fetch(bool autoPrune)
+bool GitRemote::fetch(bool autoPrune, const GitProgressCallback &onProgress)
 {
    QLog_Debug("Git", QString("Executing fetch with prune"));
 
-   const auto cmd
-       = QString("git fetch --all --tags --force %1").arg(autoPrune ? QString("--prune --prune-tags") : QString());
-   const auto ret = mGitBase->run(cmd).success;
+   const auto cmd = QString("git fetch --progress --all --tags --force %1")
+                        .arg(autoPrune ? QString("--prune --prune-tags") : QString());
+   const auto ret = mGitBase->runNetwork(cmd, onProgress).success;
 
    return ret;
 }
 
-bool GitRemote::fetchBranch(const QString &branch) const
+bool GitRemote::fetchBranch(const QString &branch, const GitProgressCallback &onProgress) const
 {
    QLog_Debug("Git", QString("Executing fetch over a branch"));
 
@@ -90,8 +95,8 @@ bool GitRemote::fetchBranch(const QString &branch) const
          remoteName = ret.output;
    }
 
-   const auto cmd = QString("git fetch %1 %2").arg(remoteName, branch);
-   const auto ret = mGitBase->run(cmd).success;
+   const auto cmd = QString("git fetch --progress %1 %2").arg(remoteName, branch);
+   const auto ret = mGitBase->runNetwork(cmd, onProgress).success;
 
    return ret;
 }
@@ -24,6 +24,7 @@
  ***************************************************************************************/
 
 #include <GitExecResult.h>
+#include <GitProgressParser.h>
 
 #include <QSharedPointer>
 
@@ -34,12 +35,14 @@ class GitRemote
 public:
    explicit GitRemote(const QSharedPointer<GitBase> &gitBase);
 
-   GitExecResult pushBranch(const QString &branchName, bool force = false);
-   GitExecResult push(bool force = false);
-   GitExecResult pushCommit(const QString &sha, const QString &remoteBranch);
-   GitExecResult pull(bool updateSubmodulesOnPull = false);
-   bool fetch(bool autoPrune = false);
-   bool fetchBranch(const QString &branch) const;
+   // The progress callback is called from the calling thread while the command runs
+   GitExecResult pushBranch(const QString &branchName, bool force = false, const GitProgressCallback &onProgress = {});
+   GitExecResult push(bool force = false, const GitProgressCallback &onProgress = {});
+   GitExecResult pushCommit(const QString &sha, const QString &remoteBranch,
+                            const GitProgressCallback &onProgress = {});
+   GitExecResult pull(bool updateSubmodulesOnPull = false, const GitProgressCallback &onProgress = {});
+   bool fetch(bool autoPrune = false, const GitProgressCallback &onProgress = {});
+   bool fetchBranch(const QString &branch, const GitProgressCallback &onProgress = {}) const;
    GitExecResult prune();
    GitExecResult addRemote(const QString &remoteRepo, const QString &remoteName);
    GitExecResult removeRemote(const QString &remoteName);
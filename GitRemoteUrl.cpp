@@ -0,0 +1,61 @@
+#include "GitRemoteUrl.h"
+
+#include <QRegularExpression>
+
+GitRemoteUrl GitRemoteUrl::parse(const QString &url)
+{
+   static const QRegularExpression schemeUrl("^([A-Za-z][A-Za-z0-9+.-]*)://(?:([^@/]*)@)?(\\[[^\\]]*\\]|[^:/]*)"
+                                             "(?::(\\d*))?(.*)$");
+   static const QRegularExpression scpUrl("^(?:([^@/]*)@)?(\\[[^\\]]*\\]|[^:/]+):(.*)$");
+   static const QRegularExpression windowsPath("^[A-Za-z]:[\\\\/]");
+
+   GitRemoteUrl remote;
+   remote.url = url;
+
+   if (url.isEmpty())
+      return remote;
+
+   if (const auto match = schemeUrl.match(url); match.hasMatch())
+   {
+      remote.scheme = match.captured(1).toLower();
+      remote.user = match.captured(2);
+      remote.host = match.captured(3);
+      remote.path = match.captured(5);
+
+      if (!match.captured(4).isEmpty())
+         remote.port = match.captured(4).toInt();
+   }
+   else if (const auto scp = scpUrl.match(url); scp.hasMatch() && !windowsPath.match(url).hasMatch())
+   {
+      remote.scheme = "ssh";
+      remote.user = scp.captured(1);
+      remote.host = scp.captured(2);
+      remote.path = scp.captured(3);
+   }
+   else
+   {
+      remote.scheme = "file";
+      remote.path = url;
+   }
+
+   if (remote.host.startsWith('[') && remote.host.endsWith(']'))
+      remote.host = remote.host.mid(1, remote.host.length() - 2);
+
+   auto path = remote.path;
+
+   while (path.endsWith('/'))
+      path.chop(1);
+
+   if (path.endsWith(".git"))
+      path.chop(4);
+
+   while (path.startsWith('/') || path.startsWith('~'))
+      path.remove(0, 1);
+
+   const auto separator = path.lastIndexOf('/');
+
+   remote.repo = path.mid(separator + 1);
+   remote.owner = separator < 0 ? QString() : path.left(separator);
+
+   return remote;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QString>
+
+// The parts of a remote URL, in any of the forms git accepts: scheme://[user@]host[:port]/path, the scp-like
+// [user@]host:path and local paths.
+struct GitRemoteUrl
+{
+   QString url;
+   // ssh, https, http, git, file... An scp-like address is ssh.
+   QString scheme;
+   QString user;
+   QString host;
+   int port = -1;
+   QString path;
+   // The namespace and the name of the repository in hosting services, from the path without .git
+   QString owner;
+   QString repo;
+
+   bool isValid() const { return !url.isEmpty(); }
+   bool isLocal() const { return scheme == "file"; }
+
+   static GitRemoteUrl parse(const QString &url);
+};
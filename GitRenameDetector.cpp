@@ -0,0 +1,371 @@
+#include "GitRenameDetector.h"
+
+#include <GitObjectDatabase.h>
+#include <ParallelFor.h>
+
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+
+#include <QLogger.h>
+
+#include <algorithm>
+
+using namespace QLogger;
+
+namespace
+{
+// Scores are computed as git does, in units of MAX_SCORE, and printed as percentages
+constexpr int MAX_SCORE = 60000;
+constexpr quint32 HASH_BASE = 107927;
+constexpr int MAX_CHUNK_SIZE = 64;
+constexpr int CANDIDATES_PER_DESTINATION = 4;
+// Below this many blobs the thread pool costs more than it saves
+constexpr int PARALLEL_THRESHOLD = 16;
+
+constexpr quint32 TYPE_MASK = 0170000;
+constexpr quint32 REGULAR_FILE = 0100000;
+constexpr quint32 SYMLINK = 0120000;
+
+constexpr ObjectId EMPTY_BLOB = ObjectId::fromHex("e69de29bb2d1d6434b8b29ae775ad8c2e48c5391", 40);
+constexpr ObjectId EMPTY_BLOB_SHA256
+    = ObjectId::fromHex("473a0f4c3be8a93681a267e3b1e9a7dcda1185436fe141f7749120a303721813", 64);
+
+bool isRenamable(quint32 mode)
+{
+   return (mode & TYPE_MASK) == REGULAR_FILE || (mode & TYPE_MASK) == SYMLINK;
+}
+
+bool isEmptyBlob(const ObjectId &id)
+{
+   return id == EMPTY_BLOB || id == EMPTY_BLOB_SHA256;
+}
+
+QString baseName(const QString &path)
+{
+   return path.mid(path.lastIndexOf('/') + 1);
+}
+}
+
+struct GitRenameDetector::Fingerprint
+{
+   // -1 when the blob couldn't be read
+   qint64 size = -1;
+   // Hash of every chunk and the bytes in the chunks with that hash, sorted by hash
+   QVector<QPair<quint32, quint32>> chunks;
+};
+
+GitRenameDetector::GitRenameDetector(const QSharedPointer<GitObjectDatabase> &objects)
+   : mObjects(objects)
+{
+}
+
+QVector<GitRenameDetector::Match> GitRenameDetector::detect(const QVector<GitTreeDiff::Change> &changes) const
+{
+   QVector<int> sources;
+   QVector<int> destinations;
+
+   for (auto i = 0; i < changes.count(); ++i)
+   {
+      const auto &change = changes.at(i);
+
+      if (change.status == 'A' && isRenamable(change.newMode) && !isEmptyBlob(change.newId))
+         destinations.append(i);
+      else if ((change.status == 'D' || (mFindCopies && change.status == 'M')) && isRenamable(change.oldMode)
+               && !isEmptyBlob(change.oldId))
+      {
+         sources.append(i);
+      }
+   }
+
+   QVector<Match> matches;
+
+   if (sources.isEmpty() || destinations.isEmpty())
+      return matches;
+
+   QSet<int> renamedSources;
+   QSet<int> matchedDestinations;
+
+   const auto sameType = [&changes](int source, int destination) {
+      return (changes.at(source).oldMode & TYPE_MASK) == (changes.at(destination).newMode & TYPE_MASK);
+   };
+
+   const auto canRename = [&changes, &renamedSources](int source) {
+      return changes.at(source).status == 'D' && !renamedSources.contains(source);
+   };
+
+   // Identical blobs first: deleted files before modified ones, and the same file name before any other
+   QHash<ObjectId, QVector<int>> sourcesById;
+
+   for (const auto source : std::as_const(sources))
+      sourcesById[changes.at(source).oldId].append(source);
+
+   for (const auto destination : std::as_const(destinations))
+   {
+      const auto candidates = sourcesById.value(changes.at(destination).newId);
+      auto best = -1;
+      auto bestRank = -1;
+
+      for (const auto source : candidates)
+      {
+         const auto rank = (canRename(source) ? 2 : 0)
+             + (baseName(changes.at(source).path) == baseName(changes.at(destination).path) ? 1 : 0);
+
+         if (sameType(source, destination) && (mFindCopies || canRename(source)) && rank > bestRank)
+         {
+            best = source;
+            bestRank = rank;
+         }
+      }
+
+      if (best == -1)
+         continue;
+
+      const auto isCopy = !canRename(best);
+
+      if (!isCopy)
+         renamedSources.insert(best);
+
+      matchedDestinations.insert(destination);
+      matches.append(Match { best, destination, 100, isCopy });
+   }
+
+   QVector<int> pendingDestinations;
+   QVector<int> pendingSources;
+
+   for (const auto destination : std::as_const(destinations))
+   {
+      if (!matchedDestinations.contains(destination))
+         pendingDestinations.append(destination);
+   }
+
+   for (const auto source : std::as_const(sources))
+   {
+      if (mFindCopies || canRename(source))
+         pendingSources.append(source);
+   }
+
+   if (pendingDestinations.isEmpty() || pendingSources.isEmpty())
+      return matches;
+
+   if (mRenameLimit > 0
+       && static_cast<qint64>(pendingDestinations.count()) * pendingSources.count()
+           > static_cast<qint64>(mRenameLimit) * mRenameLimit)
+   {
+      QLog_Debug("Git", QString("Skipping inexact rename detection: {%1} sources and {%2} destinations")
+                            .arg(pendingSources.count())
+                            .arg(pendingDestinations.count()));
+      return matches;
+   }
+
+   // Every blob is read and fingerprinted once, in parallel
+   QHash<ObjectId, int> blobPositions;
+   QVector<ObjectId> blobs;
+
+   const auto blobPosition = [&blobPositions, &blobs](const ObjectId &id) {
+      if (const auto iter = blobPositions.constFind(id); iter != blobPositions.cend())
+         return iter.value();
+
+      blobPositions.insert(id, static_cast<int>(blobs.count()));
+      blobs.append(id);
+
+      return static_cast<int>(blobs.count() - 1);
+   };
+
+   QVector<int> sourceBlobs;
+   QVector<int> destinationBlobs;
+
+   for (const auto source : std::as_const(pendingSources))
+      sourceBlobs.append(blobPosition(changes.at(source).oldId));
+
+   for (const auto destination : std::as_const(pendingDestinations))
+      destinationBlobs.append(blobPosition(changes.at(destination).newId));
+
+   const auto threadCount = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+   QVector<Fingerprint> fingerprints(blobs.count());
+   const auto fingerprintsData = fingerprints.data();
+   const auto blobChunks
+       = blobs.count() < PARALLEL_THRESHOLD ? 1 : qMin(static_cast<int>(blobs.count()), threadCount * 4);
+
+   parallelFor(blobChunks, [this, &blobs, fingerprintsData, blobChunks](int chunk) {
+      const auto count = static_cast<qint64>(blobs.count());
+      const auto end = static_cast<int>(count * (chunk + 1) / blobChunks);
+
+      for (auto i = static_cast<int>(count * chunk / blobChunks); i < end; ++i)
+      {
+         if (const auto object = mObjects->read(blobs.at(i)); object.type == GitObjectDatabase::ObjectType::Blob)
+            fingerprintsData[i] = fingerprint(object.data);
+      }
+   });
+
+   // The best candidates of every destination, also in parallel
+   const auto minimumScore = static_cast<int>(static_cast<qint64>(mSimilarity) * MAX_SCORE / 100);
+   QVector<QVector<Match>> candidates(pendingDestinations.count());
+   const auto candidatesData = candidates.data();
+   const auto destinationChunks = pendingDestinations.count() * pendingSources.count() < PARALLEL_THRESHOLD
+       ? 1
+       : qMin(static_cast<int>(pendingDestinations.count()), threadCount * 4);
+
+   parallelFor(destinationChunks, [&](int chunk) {
+      const auto count = static_cast<qint64>(pendingDestinations.count());
+      const auto end = static_cast<int>(count * (chunk + 1) / destinationChunks);
+
+      for (auto i = static_cast<int>(count * chunk / destinationChunks); i < end; ++i)
+      {
+         const auto &destination = fingerprints.at(destinationBlobs.at(i));
+         auto &best = candidatesData[i];
+
+         for (auto j = 0; j < pendingSources.count(); ++j)
+         {
+            if (!sameType(pendingSources.at(j), pendingDestinations.at(i)))
+               continue;
+
+            const auto similarity = score(fingerprints.at(sourceBlobs.at(j)), destination, minimumScore);
+
+            if (similarity < minimumScore || similarity == 0)
+               continue;
+
+            auto position = 0;
+
+            while (position < best.count() && best.at(position).similarity >= similarity)
+               ++position;
+
+            if (position < CANDIDATES_PER_DESTINATION)
+            {
+               best.insert(position, Match { pendingSources.at(j), pendingDestinations.at(i), similarity, false });
+
+               if (best.count() > CANDIDATES_PER_DESTINATION)
+                  best.removeLast();
+            }
+         }
+      }
+   });
+
+   QVector<Match> scored;
+
+   for (const auto &best : std::as_const(candidates))
+      scored.append(best);
+
+   std::stable_sort(scored.begin(), scored.end(),
+                    [](const Match &first, const Match &second) { return first.similarity > second.similarity; });
+
+   // Renames take the best pairs first; what's left can still be a copy of any source
+   for (const auto &match : std::as_const(scored))
+   {
+      if (!matchedDestinations.contains(match.destination) && canRename(match.source))
+      {
+         renamedSources.insert(match.source);
+         matchedDestinations.insert(match.destination);
+         matches.append(Match { match.source, match.destination, match.similarity * 100 / MAX_SCORE, false });
+      }
+   }
+
+   if (mFindCopies)
+   {
+      for (const auto &match : std::as_const(scored))
+      {
+         if (!matchedDestinations.contains(match.destination))
+         {
+            matchedDestinations.insert(match.destination);
+            matches.append(Match { match.source, match.destination, match.similarity * 100 / MAX_SCORE, true });
+         }
+      }
+   }
+
+   std::sort(matches.begin(), matches.end(),
+             [](const Match &first, const Match &second) { return first.destination < second.destination; });
+
+   return matches;
+}
+
+GitRenameDetector::Fingerprint GitRenameDetector::fingerprint(const QByteArray &content)
+{
+   // Same chunks as git's diffcore-delta: a line, or 64 bytes of a longer one. Text files ignore the CR of CRLF.
+   const auto data = reinterpret_cast<const uchar *>(content.constData());
+   const auto size = static_cast<qint64>(content.size());
+   const auto isText = !content.left(8000).contains('\0');
+
+   Fingerprint fingerprint;
+   fingerprint.size = size;
+
+   quint32 accumulator1 = 0;
+   quint32 accumulator2 = 0;
+   quint32 chunkSize = 0;
+
+   for (qint64 i = 0; i < size; ++i)
+   {
+      const auto c = data[i];
+
+      if (isText && c == '\r' && i + 1 < size && data[i + 1] == '\n')
+         continue;
+
+      const auto previous = accumulator1;
+      accumulator1 = (accumulator1 << 7) ^ (accumulator2 >> 25);
+      accumulator2 = (accumulator2 << 7) ^ (previous >> 25);
+      accumulator1 += c;
+
+      if (++chunkSize < MAX_CHUNK_SIZE && c != '\n')
+         continue;
+
+      fingerprint.chunks.append(qMakePair((accumulator1 + accumulator2 * 0x61) % HASH_BASE, chunkSize));
+      accumulator1 = 0;
+      accumulator2 = 0;
+      chunkSize = 0;
+   }
+
+   if (chunkSize > 0)
+      fingerprint.chunks.append(qMakePair((accumulator1 + accumulator2 * 0x61) % HASH_BASE, chunkSize));
+
+   std::sort(fingerprint.chunks.begin(), fingerprint.chunks.end());
+
+   // One entry per hash with the bytes of all its chunks
+   auto last = -1;
+
+   for (const auto &chunk : std::as_const(fingerprint.chunks))
+   {
+      if (last >= 0 && fingerprint.chunks.at(last).first == chunk.first)
+         fingerprint.chunks[last].second += chunk.second;
+      else
+         fingerprint.chunks[++last] = chunk;
+   }
+
+   fingerprint.chunks.resize(last + 1);
+
+   return fingerprint;
+}
+
+int GitRenameDetector::score(const Fingerprint &source, const Fingerprint &destination, int minimumScore)
+{
+   if (source.size <= 0 || destination.size <= 0)
+      return 0;
+
+   const auto maxSize = qMax(source.size, destination.size);
+   const auto delta = maxSize - qMin(source.size, destination.size);
+
+   // Too different in size to reach the minimum score, whatever the content
+   if (maxSize * (MAX_SCORE - minimumScore) < delta * MAX_SCORE)
+      return 0;
+
+   qint64 copied = 0;
+   auto sourcePos = 0;
+   auto destinationPos = 0;
+
+   while (sourcePos < source.chunks.count() && destinationPos < destination.chunks.count())
+   {
+      const auto &sourceChunk = source.chunks.at(sourcePos);
+      const auto &destinationChunk = destination.chunks.at(destinationPos);
+
+      if (sourceChunk.first < destinationChunk.first)
+         ++sourcePos;
+      else if (sourceChunk.first > destinationChunk.first)
+         ++destinationPos;
+      else
+      {
+         copied += qMin(sourceChunk.second, destinationChunk.second);
+         ++sourcePos;
+         ++destinationPos;
+      }
+   }
+
+   return static_cast<int>(copied * MAX_SCORE / maxSize);
+}
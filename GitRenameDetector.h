@@ -0,0 +1,73 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <GitTreeDiff.h>
+
+#include <QSharedPointer>
+#include <QVector>
+
+class GitObjectDatabase;
+
+// Rename and copy detection over the output of GitTreeDiff, as diff-tree -C does it: added files are paired with
+// deleted files (renames) or with files modified in the same diff (copies). Identical blobs are matched first; the rest
+// are compared with the same chunk fingerprints git uses, computed in parallel.
+class GitRenameDetector
+{
+public:
+   // Same defaults as git: -M50% and diff.renameLimit
+   static constexpr int DEFAULT_SIMILARITY = 50;
+   static constexpr int DEFAULT_RENAME_LIMIT = 1000;
+
+   struct Match
+   {
+      // Positions in the changes
+      int source = -1;
+      int destination = -1;
+      // Percentage, as printed by diff-tree
+      int similarity = 0;
+      bool isCopy = false;
+   };
+
+   explicit GitRenameDetector(const QSharedPointer<GitObjectDatabase> &objects);
+
+   // Minimum similarity, in percent, for files that aren't identical.
+   void setSimilarity(int similarity) { mSimilarity = similarity; }
+   // Similar content is only searched while sources × destinations stays below limit². 0 means no limit.
+   void setRenameLimit(int renameLimit) { mRenameLimit = renameLimit; }
+   void setFindCopies(bool findCopies) { mFindCopies = findCopies; }
+
+   QVector<Match> detect(const QVector<GitTreeDiff::Change> &changes) const;
+
+private:
+   struct Fingerprint;
+
+   QSharedPointer<GitObjectDatabase> mObjects;
+   int mSimilarity = DEFAULT_SIMILARITY;
+   int mRenameLimit = DEFAULT_RENAME_LIMIT;
+   bool mFindCopies = true;
+
+   static Fingerprint fingerprint(const QByteArray &content);
+   static int score(const Fingerprint &source, const Fingerprint &destination, int minimumScore);
+};
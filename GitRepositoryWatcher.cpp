@@ -0,0 +1,146 @@
+#include "GitRepositoryWatcher.h"
+
+#include <FileStamp.h>
+#include <GitBase.h>
+#include <GitRefDatabase.h>
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QTimer>
+#include <QtEndian>
+
+#include <QLogger.h>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr int DEFAULT_COALESCING_INTERVAL = 100;
+
+// Files and directories that only exist while an operation is in progress
+const char *const OPERATION_PATHS[]
+    = { "MERGE_HEAD", "CHERRY_PICK_HEAD", "REVERT_HEAD", "rebase-merge", "rebase-apply", "BISECT_LOG" };
+}
+
+GitRepositoryWatcher::GitRepositoryWatcher(const QSharedPointer<GitBase> &gitBase, QObject *parent)
+   : QObject(parent)
+   , mGitBase(gitBase)
+   , mWatcher(new QFileSystemWatcher(this))
+   , mTimer(new QTimer(this))
+{
+   mTimer->setSingleShot(true);
+   mTimer->setInterval(DEFAULT_COALESCING_INTERVAL);
+
+   connect(mTimer, &QTimer::timeout, this, &GitRepositoryWatcher::checkChanges);
+   connect(mWatcher, &QFileSystemWatcher::directoryChanged, this, &GitRepositoryWatcher::onPathChanged);
+   connect(mWatcher, &QFileSystemWatcher::fileChanged, this, &GitRepositoryWatcher::onPathChanged);
+
+   mState = readState();
+   updateWatchedPaths();
+}
+
+void GitRepositoryWatcher::setCoalescingInterval(int msecs)
+{
+   mTimer->setInterval(msecs);
+}
+
+void GitRepositoryWatcher::onPathChanged()
+{
+   // Not restarted on every event, so a long operation still gets reported while it runs
+   if (!mTimer->isActive())
+      mTimer->start();
+}
+
+void GitRepositoryWatcher::checkChanges()
+{
+   const auto state = readState();
+   const auto previous = mState;
+
+   mState = state;
+
+   // Directories created under refs/ or by an operation need their own watch
+   updateWatchedPaths();
+
+   if (state.refs != previous.refs)
+      emit signalRefsChanged();
+
+   if (state.headBranch != previous.headBranch || state.headSha != previous.headSha)
+   {
+      QLog_Debug("Git", QString("HEAD moved to {%1}").arg(state.headSha));
+      emit signalHeadMoved(state.headBranch, state.headSha);
+   }
+
+   if (state.index != previous.index)
+      emit signalIndexChanged();
+
+   if (state.operation != previous.operation)
+      emit signalOperationStateChanged();
+}
+
+GitRepositoryWatcher::State GitRepositoryWatcher::readState() const
+{
+   const auto refs = mGitBase->getRefDatabase();
+   const auto gitDir = mGitBase->getGitDir();
+   const auto head = refs->resolve("HEAD");
+
+   State state;
+   state.headSha = head.sha;
+   state.headBranch = head.symbolicTarget.startsWith("refs/heads/") ? head.symbolicTarget.mid(11) : QString();
+   state.refs = refs->signature();
+   state.index = fileStamp(QString("%1/index").arg(gitDir));
+
+   for (const auto path : OPERATION_PATHS)
+   {
+      const auto stamp = qToBigEndian(fileStamp(QString("%1/%2").arg(gitDir, QString::fromUtf8(path))));
+      state.operation.append(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+   }
+
+   return state;
+}
+
+void GitRepositoryWatcher::updateWatchedPaths()
+{
+   const auto gitDir = mGitBase->getGitDir();
+   const auto commonDir = mGitBase->getGitCommonDir();
+
+   // Git replaces files with a rename, which is seen from the directory holding them: the git dir covers HEAD,
+   // index, packed-refs and the operation files
+   QStringList paths { gitDir, commonDir };
+
+   for (const auto &dir : { gitDir, commonDir })
+   {
+      for (const auto operationPath : { "rebase-merge", "rebase-apply" })
+      {
+         if (const auto path = QString("%1/%2").arg(dir, QString::fromUtf8(operationPath)); QFileInfo(path).isDir())
+            paths.append(path);
+      }
+
+      const auto refsDir = QString("%1/refs").arg(dir);
+
+      if (!QFileInfo(refsDir).isDir())
+         continue;
+
+      paths.append(refsDir);
+
+      QDirIterator iter(refsDir, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden, QDirIterator::Subdirectories);
+
+      while (iter.hasNext())
+         paths.append(iter.next());
+   }
+
+   // Repositories with many branch folders have many directories to compare
+   const auto wanted = QSet<QString>(paths.cbegin(), paths.cend());
+   const auto watchedList = mWatcher->directories();
+   const auto watched = QSet<QString>(watchedList.cbegin(), watchedList.cend());
+   const auto removed = (watched - wanted).values();
+   const auto added = (wanted - watched).values();
+
+   if (!removed.isEmpty())
+      mWatcher->removePaths(removed);
+
+   if (!added.isEmpty())
+      mWatcher->addPaths(added);
+}
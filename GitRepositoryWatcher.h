@@ -0,0 +1,74 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+
+class GitBase;
+class QFileSystemWatcher;
+class QTimer;
+
+// Watches the git directory for changes made outside the application, as commands run in a terminal or hooks. The
+// bursts of events a git command produces are coalesced and reported once, by kind of change.
+class GitRepositoryWatcher : public QObject
+{
+   Q_OBJECT
+
+signals:
+   // HEAD moved to another commit or branch. The branch is empty when detached.
+   void signalHeadMoved(QString branch, QString sha);
+   void signalRefsChanged();
+   void signalIndexChanged();
+   // A merge, cherry-pick, revert or rebase started, advanced or finished
+   void signalOperationStateChanged();
+
+public:
+   explicit GitRepositoryWatcher(const QSharedPointer<GitBase> &gitBase, QObject *parent = nullptr);
+
+   // Events closer than this are reported together
+   void setCoalescingInterval(int msecs);
+
+private:
+   struct State
+   {
+      QString headBranch;
+      QString headSha;
+      QByteArray refs;
+      qint64 index = -1;
+      QByteArray operation;
+   };
+
+   QSharedPointer<GitBase> mGitBase;
+   QFileSystemWatcher *mWatcher = nullptr;
+   QTimer *mTimer = nullptr;
+   State mState;
+
+   void onPathChanged();
+   void checkChanges();
+   State readState() const;
+   void updateWatchedPaths();
+};
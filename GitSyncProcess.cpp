@@ -19,3 +19,19 @@ GitExecResult GitSyncProcess::run(const QString &command)
 
    return { !mRealError, mRunOutput };
 }
+
+GitExecResult GitSyncProcess::run(const QString &command, const QByteArray &input)
+{
+   const auto processStarted = execute(command);
+
+   if (processStarted)
+   {
+      write(input);
+      closeWriteChannel();
+      waitForFinished(10000);
+   }
+
+   close();
+
+   return { !mRealError, mRunOutput };
+}
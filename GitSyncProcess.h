@@ -31,4 +31,5 @@ public:
    GitSyncProcess(const QString &workingDir);
 
    GitExecResult run(const QString &command) override;
+   GitExecResult run(const QString &command, const QByteArray &input);
 };
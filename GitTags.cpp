@@ -1,5 +1,7 @@
 #include <GitAsyncProcess.h>
 #include <GitBase.h>
+#include <GitObjectDatabase.h>
+#include <GitRefDatabase.h>
 #include <GitTags.h>
 #include <QLogger.h>
 
@@ -96,6 +98,9 @@ GitExecResult GitTags::getTagCommit(const QString &tagName)
 {
    QLog_Debug("Git", QString("Getting the commit of a tag: {%1}").arg(tagName));
 
+   if (const auto commit = readTagCommit(tagName); !commit.isNull())
+      return GitExecResult(true, commit.toString());
+
    const auto cmd = QString("git rev-list -n 1 %1").arg(tagName);
 
    QLog_Trace("Git", QString("Getting the commit of a tag: {%1}").arg(cmd));
@@ -106,6 +111,47 @@ GitExecResult GitTags::getTagCommit(const QString &tagName)
    return qMakePair(ret.success, output);
 }
 
+ObjectId GitTags::getTagCommitId(const QString &tagName)
+{
+   QLog_Debug("Git", QString("Getting the commit id of a tag: {%1}").arg(tagName));
+
+   if (const auto commit = readTagCommit(tagName); !commit.isNull())
+      return commit;
+
+   const auto ret = mGitBase->run(QString("git rev-list -n 1 %1").arg(tagName));
+
+   return ret.success ? ObjectId::fromString(ret.output.trimmed()) : ObjectId();
+}
+
+ObjectId GitTags::readTagCommit(const QString &tagName) const
+{
+   const auto refs = mGitBase->getRefDatabase();
+
+   if (!refs->isSupported())
+      return ObjectId();
+
+   const auto ref = refs->resolveShortName(tagName);
+
+   // Tags can point to other tags. Anything that can't be read here is left to git.
+   const auto objects = mGitBase->getObjectDatabase();
+   auto current = ObjectId::fromString(ref.peeledSha.isEmpty() ? ref.sha : ref.peeledSha);
+
+   for (auto depth = 0; depth < 10 && !current.isNull(); ++depth)
+   {
+      const auto object = objects->read(current);
+
+      if (object.type == GitObjectDatabase::ObjectType::Commit)
+         return current;
+
+      if (object.type != GitObjectDatabase::ObjectType::Tag)
+         return ObjectId();
+
+      current = GitObjectDatabase::parseTag(object.data).object;
+   }
+
+   return ObjectId();
+}
+
 void GitTags::onRemoteTagsRecieved(GitExecResult result)
 {
    QMap<QString, QString> tags;
@@ -24,6 +24,7 @@
  ***************************************************************************************/
 
 #include <GitExecResult.h>
+#include <ObjectId.h>
 
 #include <QSharedPointer>
 #include <QString>
@@ -46,9 +47,13 @@ public:
    GitExecResult removeTag(const QString &tagName, bool remote);
    GitExecResult pushTag(const QString &tagName);
    GitExecResult getTagCommit(const QString &tagName);
+   // Null when the tag doesn't exist or doesn't lead to a commit
+   ObjectId getTagCommitId(const QString &tagName);
 
 private:
    QSharedPointer<GitBase> mGitBase;
 
+   // The commit the tag leads to, read from the refs and the object database. Null when git has to be asked.
+   ObjectId readTagCommit(const QString &tagName) const;
    void onRemoteTagsRecieved(GitExecResult result);
 };
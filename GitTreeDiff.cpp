@@ -0,0 +1,171 @@
+#include "GitTreeDiff.h"
+
+#include <GitObjectDatabase.h>
+
+#include <QLogger.h>
+
+using namespace QLogger;
+
+namespace
+{
+constexpr quint32 TYPE_MASK = 0170000;
+
+// Git's tree order: the name of a tree compares as if it ended with '/'
+int compareEntries(const GitObjectDatabase::TreeEntry &first, const GitObjectDatabase::TreeEntry &second)
+{
+   const auto length = qMin(first.name.size(), second.name.size());
+
+   for (auto i = 0; i < length; ++i)
+   {
+      if (const auto a = first.name.at(i).unicode(), b = second.name.at(i).unicode(); a != b)
+         return a < b ? -1 : 1;
+   }
+
+   const auto firstNext = first.name.size() > length ? first.name.at(length).unicode() : first.isTree() ? '/' : 0;
+   const auto secondNext = second.name.size() > length ? second.name.at(length).unicode() : second.isTree() ? '/' : 0;
+
+   return firstNext < secondNext ? -1 : firstNext > secondNext ? 1 : 0;
+}
+}
+
+GitTreeDiff::GitTreeDiff(const QSharedPointer<GitObjectDatabase> &objects)
+   : mObjects(objects)
+{
+}
+
+bool GitTreeDiff::diff(const ObjectId &oldTree, const ObjectId &newTree, QVector<Change> &changes) const
+{
+   changes.clear();
+
+   return diffTrees(oldTree, newTree, QString(), changes);
+}
+
+bool GitTreeDiff::diffCommits(const ObjectId &oldCommit, const ObjectId &newCommit, QVector<Change> &changes) const
+{
+   const auto newTree = commitTree(newCommit);
+   const auto oldTree = oldCommit.isNull() ? ObjectId() : commitTree(oldCommit);
+
+   if (newTree.isNull() || (!oldCommit.isNull() && oldTree.isNull()))
+   {
+      QLog_Debug("Git", QString("Can't diff {%1} and {%2} in-process").arg(oldCommit.toString(), newCommit.toString()));
+      return false;
+   }
+
+   return diff(oldTree, newTree, changes);
+}
+
+ObjectId GitTreeDiff::commitTree(const ObjectId &id) const
+{
+   if (id == INIT_OID)
+      return id;
+
+   const auto object = mObjects->read(id);
+
+   if (object.type == GitObjectDatabase::ObjectType::Tree)
+      return id;
+
+   if (object.type != GitObjectDatabase::ObjectType::Commit)
+      return ObjectId();
+
+   return GitObjectDatabase::parseCommit(object.data).tree;
+}
+
+bool GitTreeDiff::diffTrees(const ObjectId &oldTree, const ObjectId &newTree, const QString &prefix,
+                            QVector<Change> &changes) const
+{
+   if (oldTree == newTree)
+      return true;
+
+   QVector<GitObjectDatabase::TreeEntry> oldEntries;
+   QVector<GitObjectDatabase::TreeEntry> newEntries;
+
+   if ((!oldTree.isNull() && !mObjects->readTree(oldTree, oldEntries))
+       || (!newTree.isNull() && !mObjects->readTree(newTree, newEntries)))
+   {
+      return false;
+   }
+
+   auto oldPos = 0;
+   auto newPos = 0;
+
+   // Both trees are sorted: a merge finds the entries only on one side and the ones on both
+   while (oldPos < oldEntries.count() || newPos < newEntries.count())
+   {
+      const auto cmp = oldPos == oldEntries.count() ? 1
+          : newPos == newEntries.count()            ? -1
+                                                    : compareEntries(oldEntries.at(oldPos), newEntries.at(newPos));
+
+      if (cmp < 0)
+      {
+         const auto &entry = oldEntries.at(oldPos++);
+         const auto path = prefix + entry.name;
+
+         if (entry.isTree())
+         {
+            if (!addTree(entry.id, path + '/', 'D', changes))
+               return false;
+         }
+         else
+            changes.append(Change { 'D', path, entry.mode, 0, entry.id, ObjectId() });
+      }
+      else if (cmp > 0)
+      {
+         const auto &entry = newEntries.at(newPos++);
+         const auto path = prefix + entry.name;
+
+         if (entry.isTree())
+         {
+            if (!addTree(entry.id, path + '/', 'A', changes))
+               return false;
+         }
+         else
+            changes.append(Change { 'A', path, 0, entry.mode, ObjectId(), entry.id });
+      }
+      else
+      {
+         const auto &oldEntry = oldEntries.at(oldPos++);
+         const auto &newEntry = newEntries.at(newPos++);
+
+         if (oldEntry.id == newEntry.id && oldEntry.mode == newEntry.mode)
+            continue;
+
+         const auto path = prefix + newEntry.name;
+
+         if (newEntry.isTree())
+         {
+            if (!diffTrees(oldEntry.id, newEntry.id, path + '/', changes))
+               return false;
+         }
+         else
+         {
+            const auto status = (oldEntry.mode & TYPE_MASK) != (newEntry.mode & TYPE_MASK) ? 'T' : 'M';
+            changes.append(Change { status, path, oldEntry.mode, newEntry.mode, oldEntry.id, newEntry.id });
+         }
+      }
+   }
+
+   return true;
+}
+
+bool GitTreeDiff::addTree(const ObjectId &tree, const QString &prefix, char status, QVector<Change> &changes) const
+{
+   QVector<GitObjectDatabase::TreeEntry> entries;
+
+   if (!mObjects->readTree(tree, entries))
+      return false;
+
+   for (const auto &entry : std::as_const(entries))
+   {
+      if (entry.isTree())
+      {
+         if (!addTree(entry.id, prefix + entry.name + '/', status, changes))
+            return false;
+      }
+      else if (status == 'A')
+         changes.append(Change { status, prefix + entry.name, 0, entry.mode, ObjectId(), entry.id });
+      else
+         changes.append(Change { status, prefix + entry.name, entry.mode, 0, entry.id, ObjectId() });
+   }
+
+   return true;
+}
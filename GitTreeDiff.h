@@ -0,0 +1,67 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <ObjectId.h>
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+class GitObjectDatabase;
+
+// Tree-to-tree diff over the object database, with the output of diff-tree -r (without rename detection). Subtrees
+// with the same id on both sides are skipped without being read.
+class GitTreeDiff
+{
+public:
+   struct Change
+   {
+      // A, D, M or T, as diff-tree prints them
+      char status = 'M';
+      QString path;
+      quint32 oldMode = 0;
+      quint32 newMode = 0;
+      // Null on the side where the file doesn't exist
+      ObjectId oldId;
+      ObjectId newId;
+   };
+
+   explicit GitTreeDiff(const QSharedPointer<GitObjectDatabase> &objects);
+
+   // Changes in path order. A null id stands for the empty tree. False if some tree couldn't be read.
+   bool diff(const ObjectId &oldTree, const ObjectId &newTree, QVector<Change> &changes) const;
+   // The same between the trees of two commits. A null oldCommit stands for the empty tree.
+   bool diffCommits(const ObjectId &oldCommit, const ObjectId &newCommit, QVector<Change> &changes) const;
+
+   // The root tree of a commit, or a null id when it can't be read. Tree ids are returned as they are.
+   ObjectId commitTree(const ObjectId &id) const;
+
+private:
+   QSharedPointer<GitObjectDatabase> mObjects;
+
+   bool diffTrees(const ObjectId &oldTree, const ObjectId &newTree, const QString &prefix,
+                  QVector<Change> &changes) const;
+   bool addTree(const ObjectId &tree, const QString &prefix, char status, QVector<Change> &changes) const;
+};
@@ -0,0 +1,381 @@
+#include "IntralineDiff.h"
+
+#include <ParallelFor.h>
+
+#include <QThreadPool>
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define INTRALINE_SSE2
+#endif
+
+namespace
+{
+// Past this number of edits the tokens of the line are considered different as a whole. It keeps huge single-line
+// files (minified sources, generated code) linear instead of quadratic.
+constexpr int MAX_EDIT_DISTANCE = 256;
+
+// Amount of characters from which the pairs are compared in parallel
+constexpr qint64 PARALLEL_THRESHOLD = 64 * 1024;
+
+enum class CharClass
+{
+   Word,
+   Space,
+   Punctuation
+};
+
+struct Token
+{
+   int start = 0;
+   int length = 0;
+   uint hash = 0;
+};
+
+CharClass classOf(ushort c)
+{
+   if (c >= 0x80 || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')
+      return CharClass::Word;
+
+   return c == ' ' || c == '\t' || c == '\r' ? CharClass::Space : CharClass::Punctuation;
+}
+
+#ifdef INTRALINE_SSE2
+__m128i load(const ushort *data)
+{
+   return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+}
+
+// Lanes between lo and hi (both included), as an unsigned comparison
+__m128i inRange(__m128i chars, ushort lo, ushort hi)
+{
+   const auto shifted = _mm_sub_epi16(chars, _mm_set1_epi16(static_cast<short>(lo)));
+   const auto over = _mm_subs_epu16(shifted, _mm_set1_epi16(static_cast<short>(hi - lo)));
+
+   return _mm_cmpeq_epi16(over, _mm_setzero_si128());
+}
+
+int classMask(__m128i chars, CharClass charClass)
+{
+   __m128i matches;
+
+   if (charClass == CharClass::Word)
+   {
+      const auto ascii = inRange(chars, 0, 0x7f);
+      matches = _mm_or_si128(_mm_andnot_si128(ascii, _mm_set1_epi16(-1)), inRange(chars, 'a', 'z'));
+      matches = _mm_or_si128(matches, inRange(chars, 'A', 'Z'));
+      matches = _mm_or_si128(matches, inRange(chars, '0', '9'));
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi16(chars, _mm_set1_epi16('_')));
+   }
+   else
+   {
+      matches = _mm_cmpeq_epi16(chars, _mm_set1_epi16(' '));
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi16(chars, _mm_set1_epi16('\t')));
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi16(chars, _mm_set1_epi16('\r')));
+   }
+
+   return _mm_movemask_epi8(matches);
+}
+#endif
+
+// End of the run of characters of the same class that starts at pos
+int runEnd(const ushort *data, int pos, int end, CharClass charClass)
+{
+   auto i = pos + 1;
+
+#ifdef INTRALINE_SSE2
+   for (; i + 8 <= end; i += 8)
+   {
+      if (const auto mask = classMask(load(data + i), charClass); mask != 0xffff)
+         return i + static_cast<int>(qCountTrailingZeroBits(static_cast<quint32>(~mask & 0xffff))) / 2;
+   }
+#endif
+
+   while (i < end && classOf(data[i]) == charClass)
+      ++i;
+
+   return i;
+}
+
+int commonPrefix(const ushort *a, const ushort *b, int length)
+{
+   auto i = 0;
+
+#ifdef INTRALINE_SSE2
+   for (; i + 8 <= length; i += 8)
+   {
+      if (const auto mask = _mm_movemask_epi8(_mm_cmpeq_epi16(load(a + i), load(b + i))); mask != 0xffff)
+         return i + static_cast<int>(qCountTrailingZeroBits(static_cast<quint32>(~mask & 0xffff))) / 2;
+   }
+#endif
+
+   while (i < length && a[i] == b[i])
+      ++i;
+
+   return i;
+}
+
+// Common suffix of a[0, aEnd) and b[0, bEnd), limited to length characters
+int commonSuffix(const ushort *a, int aEnd, const ushort *b, int bEnd, int length)
+{
+   auto i = 0;
+
+#ifdef INTRALINE_SSE2
+   for (; i + 8 <= length; i += 8)
+   {
+      const auto mask = _mm_movemask_epi8(_mm_cmpeq_epi16(load(a + aEnd - i - 8), load(b + bEnd - i - 8)));
+
+      if (mask != 0xffff)
+         return i + static_cast<int>(qCountLeadingZeroBits(static_cast<quint16>(~mask & 0xffff))) / 2;
+   }
+#endif
+
+   while (i < length && a[aEnd - i - 1] == b[bEnd - i - 1])
+      ++i;
+
+   return i;
+}
+
+QVector<Token> tokenize(const ushort *data, int start, int end)
+{
+   QVector<Token> tokens;
+
+   for (auto pos = start; pos < end;)
+   {
+      const auto charClass = classOf(data[pos]);
+      const auto tokenEnd = charClass == CharClass::Punctuation ? pos + 1 : runEnd(data, pos, end, charClass);
+
+      auto hash = 2166136261u;
+
+      for (auto i = pos; i < tokenEnd; ++i)
+         hash = (hash ^ data[i]) * 16777619u;
+
+      tokens.append(Token { pos, tokenEnd - pos, hash });
+      pos = tokenEnd;
+   }
+
+   return tokens;
+}
+
+bool sameToken(const Token &a, const ushort *aData, const Token &b, const ushort *bData)
+{
+   return a.hash == b.hash && a.length == b.length
+       && memcmp(aData + a.start, bData + b.start, static_cast<size_t>(a.length) * sizeof(ushort)) == 0;
+}
+
+// Myers' O(ND) algorithm. Returns the matched tokens as (a, b) index pairs from the last to the first, or false when
+// the edit distance goes over MAX_EDIT_DISTANCE.
+bool matchTokens(const QVector<Token> &a, const ushort *aData, const QVector<Token> &b, const ushort *bData,
+                 QVector<QPair<int, int>> &matches)
+{
+   const auto n = static_cast<int>(a.count());
+   const auto m = static_cast<int>(b.count());
+   const auto maxDistance = qMin(n + m, MAX_EDIT_DISTANCE);
+   const auto offset = maxDistance + 1;
+
+   QVector<int> v(2 * maxDistance + 3, 0);
+   QVector<QVector<int>> trace;
+
+   for (auto d = 0; d <= maxDistance; ++d)
+   {
+      trace.append(v);
+
+      for (auto k = -d; k <= d; k += 2)
+      {
+         auto x = k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]) ? v[offset + k + 1]
+                                                                                : v[offset + k - 1] + 1;
+         auto y = x - k;
+
+         while (x < n && y < m && sameToken(a[x], aData, b[y], bData))
+         {
+            ++x;
+            ++y;
+         }
+
+         v[offset + k] = x;
+
+         if (x >= n && y >= m)
+         {
+            x = n;
+            y = m;
+
+            for (auto step = d; step >= 0; --step)
+            {
+               const auto &previous = trace.at(step);
+               const auto currentK = x - y;
+               const auto previousK
+                   = currentK == -step
+                       || (currentK != step && previous[offset + currentK - 1] < previous[offset + currentK + 1])
+                   ? currentK + 1
+                   : currentK - 1;
+               const auto previousX = step == 0 ? 0 : previous[offset + previousK];
+               const auto previousY = step == 0 ? 0 : previousX - previousK;
+
+               while (x > previousX && y > previousY)
+               {
+                  --x;
+                  --y;
+                  matches.append(qMakePair(x, y));
+               }
+
+               x = previousX;
+               y = previousY;
+            }
+
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+// Appends the unmatched tokens between two matches as a single range
+void appendRange(QVector<IntralineDiff::Range> &ranges, const QVector<Token> &tokens, int from, int to)
+{
+   if (from >= to)
+      return;
+
+   const auto start = tokens.at(from).start;
+   const auto end = tokens.at(to - 1).start + tokens.at(to - 1).length;
+
+   if (!ranges.isEmpty() && ranges.last().start + ranges.last().length == start)
+      ranges.last().length += end - start;
+   else
+      ranges.append(IntralineDiff::Range { start, end - start });
+}
+}
+
+QVector<QPair<QString, QString>> IntralineDiff::pairChangedLines(const QString &diff)
+{
+   QVector<QPair<QString, QString>> pairs;
+   QStringList removed;
+   QStringList added;
+
+   const auto flush = [&pairs, &removed, &added]() {
+      const auto count = qMin(removed.count(), added.count());
+
+      for (auto i = 0; i < count; ++i)
+         pairs.append(qMakePair(removed.at(i), added.at(i)));
+
+      removed.clear();
+      added.clear();
+   };
+
+   auto inHunk = false;
+   const auto lines = diff.split('\n');
+
+   for (const auto &line : lines)
+   {
+      if (line.startsWith("@@"))
+      {
+         flush();
+         inHunk = true;
+      }
+      else if (line.startsWith("diff "))
+      {
+         flush();
+         inHunk = false;
+      }
+      else if (inHunk && line.startsWith('-'))
+      {
+         if (!added.isEmpty())
+            flush();
+
+         removed.append(line.mid(1));
+      }
+      else if (inHunk && line.startsWith('+'))
+         added.append(line.mid(1));
+      else if (!line.startsWith('\\'))
+         flush();
+   }
+
+   flush();
+
+   return pairs;
+}
+
+IntralineDiff::LineChanges IntralineDiff::compare(const QString &removedLine, const QString &addedLine)
+{
+   LineChanges changes;
+
+   const auto a = removedLine.utf16();
+   const auto b = addedLine.utf16();
+   const auto aLength = static_cast<int>(removedLine.size());
+   const auto bLength = static_cast<int>(addedLine.size());
+
+   auto prefix = commonPrefix(a, b, qMin(aLength, bLength));
+   auto suffix = commonSuffix(a, aLength, b, bLength, qMin(aLength, bLength) - prefix);
+
+   if (prefix + suffix == aLength && prefix + suffix == bLength)
+      return changes;
+
+   // The trimmed parts can't end in the middle of a word or it would be reported only partially changed
+   const auto isWord = [](const ushort *data, int length, int pos) {
+      return pos >= 0 && pos < length && classOf(data[pos]) == CharClass::Word;
+   };
+
+   while (prefix > 0 && isWord(a, aLength, prefix - 1) && (isWord(a, aLength, prefix) || isWord(b, bLength, prefix)))
+      --prefix;
+
+   while (suffix > 0 && isWord(a, aLength, aLength - suffix)
+          && (isWord(a, aLength, aLength - suffix - 1) || isWord(b, bLength, bLength - suffix - 1)))
+      --suffix;
+
+   const auto aTokens = tokenize(a, prefix, aLength - suffix);
+   const auto bTokens = tokenize(b, prefix, bLength - suffix);
+
+   QVector<QPair<int, int>> matches;
+
+   if (!matchTokens(aTokens, a, bTokens, b, matches))
+      matches.clear();
+
+   // Matches come from the end of the line, so they are walked backwards to produce the ranges in order
+   auto aNext = 0;
+   auto bNext = 0;
+
+   for (auto i = matches.count() - 1; i >= 0; --i)
+   {
+      appendRange(changes.removed, aTokens, aNext, matches.at(i).first);
+      appendRange(changes.added, bTokens, bNext, matches.at(i).second);
+
+      aNext = matches.at(i).first + 1;
+      bNext = matches.at(i).second + 1;
+   }
+
+   appendRange(changes.removed, aTokens, aNext, static_cast<int>(aTokens.count()));
+   appendRange(changes.added, bTokens, bNext, static_cast<int>(bTokens.count()));
+
+   return changes;
+}
+
+QVector<IntralineDiff::LineChanges> IntralineDiff::compare(const QVector<QPair<QString, QString>> &linePairs)
+{
+   QVector<LineChanges> changes(linePairs.count());
+   const auto output = changes.data();
+
+   qint64 totalSize = 0;
+
+   for (const auto &pair : linePairs)
+      totalSize += pair.first.size() + pair.second.size();
+
+   const auto pool = QThreadPool::globalInstance();
+   const auto chunkCount = totalSize < PARALLEL_THRESHOLD
+       ? 1
+       : static_cast<int>(qMin<qsizetype>(linePairs.count(), qMax(1, pool->maxThreadCount()) * 4));
+
+   const auto compareChunk = [&linePairs, output, chunkCount](int chunk) {
+      const auto count = static_cast<int>(linePairs.count());
+      const auto end = static_cast<int>(static_cast<qint64>(count) * (chunk + 1) / chunkCount);
+
+      for (auto i = static_cast<int>(static_cast<qint64>(count) * chunk / chunkCount); i < end; ++i)
+         output[i] = compare(linePairs.at(i).first, linePairs.at(i).second);
+   };
+
+   parallelFor(chunkCount, compareChunk);
+
+   return changes;
+}
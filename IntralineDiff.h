@@ -0,0 +1,54 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+// Word-level differences inside changed lines. Lines are split in words, whitespace runs and single punctuation
+// characters, and the tokens are compared with Myers' algorithm after trimming the common prefix and suffix.
+class IntralineDiff
+{
+public:
+   struct Range
+   {
+      int start = 0;
+      int length = 0;
+   };
+
+   struct LineChanges
+   {
+      QVector<Range> removed;
+      QVector<Range> added;
+   };
+
+   // Pairs the removed and added lines of every hunk of a unified diff, in the order they appear. The +/- markers
+   // are removed from the lines.
+   static QVector<QPair<QString, QString>> pairChangedLines(const QString &diff);
+
+   static LineChanges compare(const QString &removedLine, const QString &addedLine);
+   // Big sets of lines are split across the global thread pool.
+   static QVector<LineChanges> compare(const QVector<QPair<QString, QString>> &linePairs);
+};
@@ -0,0 +1,90 @@
+#include "ObjectId.h"
+
+ObjectId ObjectId::fromString(const QString &sha)
+{
+   if (sha.size() != 2 * SHA1_SIZE && sha.size() != 2 * SHA256_SIZE)
+      return ObjectId();
+
+   const auto latin1 = sha.toLatin1();
+
+   return fromHex(latin1.constData(), static_cast<int>(latin1.size()));
+}
+
+ObjectId ObjectId::fromRaw(const QByteArray &raw)
+{
+   return fromRaw(reinterpret_cast<const unsigned char *>(raw.constData()), static_cast<int>(raw.size()));
+}
+
+ObjectId ObjectId::fromRaw(const unsigned char *data, int size)
+{
+   ObjectId id;
+
+   if (size == SHA1_SIZE || size == SHA256_SIZE)
+   {
+      memcpy(id.mBytes, data, static_cast<size_t>(size));
+      id.mSize = static_cast<unsigned char>(size);
+   }
+
+   return id;
+}
+
+QByteArray ObjectId::toRaw() const
+{
+   return QByteArray(reinterpret_cast<const char *>(mBytes), mSize);
+}
+
+QString ObjectId::toString() const
+{
+   static constexpr char digits[] = "0123456789abcdef";
+
+   QString hex(2 * mSize, Qt::Uninitialized);
+   auto output = hex.data();
+
+   for (auto i = 0; i < mSize; ++i)
+   {
+      *output++ = QLatin1Char(digits[mBytes[i] >> 4]);
+      *output++ = QLatin1Char(digits[mBytes[i] & 0xf]);
+   }
+
+   return hex;
+}
+
+QString ObjectId::abbreviated(int length) const
+{
+   return toString().left(length);
+}
+
+bool ObjectId::startsWith(const QString &prefix) const
+{
+   if (prefix.size() > 2 * mSize)
+      return false;
+
+   for (auto i = 0; i < prefix.size(); ++i)
+   {
+      const auto value = hexValue(static_cast<char>(prefix.at(i).toLatin1()));
+      const auto digit = i % 2 == 0 ? mBytes[i / 2] >> 4 : mBytes[i / 2] & 0xf;
+
+      if (value != digit)
+         return false;
+   }
+
+   return true;
+}
+
+int ObjectId::uniquePrefixLength(const ObjectId &other) const
+{
+   auto length = 0;
+
+   while (length < 2 * mSize)
+   {
+      const auto digit = length % 2 == 0 ? mBytes[length / 2] >> 4 : mBytes[length / 2] & 0xf;
+      const auto otherDigit = length % 2 == 0 ? other.mBytes[length / 2] >> 4 : other.mBytes[length / 2] & 0xf;
+
+      if (digit != otherDigit)
+         break;
+
+      ++length;
+   }
+
+   return qMin(length + 1, 2 * static_cast<int>(mSize));
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QHashFunctions>
+#include <QString>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define OBJECTID_SSE2
+#endif
+
+// Binary object name: 20 bytes for SHA-1 repositories, 32 for SHA-256 ones. The unused bytes are always zero, so
+// comparing and hashing never look at the size. Trivially copyable and a fifth of the size of the hex QString.
+class ObjectId
+{
+public:
+   static constexpr int SHA1_SIZE = 20;
+   static constexpr int SHA256_SIZE = 32;
+
+   constexpr ObjectId() = default;
+
+   // Null when the text isn't 40 or 64 hex digits.
+   static constexpr ObjectId fromHex(const char *hex, int length)
+   {
+      ObjectId id;
+
+      if (length != 2 * SHA1_SIZE && length != 2 * SHA256_SIZE)
+         return id;
+
+      for (auto i = 0; i < length; i += 2)
+      {
+         const auto high = hexValue(hex[i]);
+         const auto low = hexValue(hex[i + 1]);
+
+         if (high < 0 || low < 0)
+            return ObjectId();
+
+         id.mBytes[i / 2] = static_cast<unsigned char>(high << 4 | low);
+      }
+
+      id.mSize = static_cast<unsigned char>(length / 2);
+
+      return id;
+   }
+
+   static ObjectId fromString(const QString &sha);
+   static ObjectId fromRaw(const QByteArray &raw);
+   static ObjectId fromRaw(const unsigned char *data, int size);
+
+   constexpr bool isNull() const { return mSize == 0; }
+   constexpr int size() const { return mSize; }
+   const unsigned char *data() const { return mBytes; }
+
+   constexpr bool isZero() const
+   {
+      for (auto i = 0; i < mSize; ++i)
+      {
+         if (mBytes[i] != 0)
+            return false;
+      }
+
+      return mSize != 0;
+   }
+
+   QByteArray toRaw() const;
+   QString toString() const;
+   // The first length hex digits, as git log --abbrev does.
+   QString abbreviated(int length = 7) const;
+   // True when the hex form starts with prefix (any case). Used to resolve abbreviated names.
+   bool startsWith(const QString &prefix) const;
+   // Hex digits needed to tell this object apart from other, plus one, as git does when abbreviating.
+   int uniquePrefixLength(const ObjectId &other) const;
+
+   bool operator==(const ObjectId &other) const
+   {
+#ifdef OBJECTID_SSE2
+      const auto first = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(mBytes)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(other.mBytes)));
+      const auto second = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(mBytes + 16)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(other.mBytes + 16)));
+
+      return _mm_movemask_epi8(_mm_and_si128(first, second)) == 0xffff && mSize == other.mSize;
+#else
+      return mSize == other.mSize && memcmp(mBytes, other.mBytes, SHA256_SIZE) == 0;
+#endif
+   }
+
+   bool operator!=(const ObjectId &other) const { return !(*this == other); }
+   bool operator<(const ObjectId &other) const { return memcmp(mBytes, other.mBytes, SHA256_SIZE) < 0; }
+
+   // The bytes of a hash are already uniformly distributed: the first word is as good a hash as any
+   quint64 hashWord() const
+   {
+      quint64 word;
+      memcpy(&word, mBytes, sizeof(word));
+
+      return word;
+   }
+
+private:
+   alignas(8) unsigned char mBytes[SHA256_SIZE] {};
+   unsigned char mSize = 0;
+
+   static constexpr int hexValue(char c)
+   {
+      if (c >= '0' && c <= '9')
+         return c - '0';
+      else if (c >= 'a' && c <= 'f')
+         return c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+         return c - 'A' + 10;
+
+      return -1;
+   }
+};
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+inline size_t qHash(const ObjectId &id, size_t seed = 0)
+{
+   return static_cast<size_t>(id.hashWord()) ^ seed;
+}
+#else
+inline uint qHash(const ObjectId &id, uint seed = 0)
+{
+   const auto word = id.hashWord();
+
+   return static_cast<uint>(word ^ (word >> 32)) ^ seed;
+}
+#endif
+
+static constexpr ObjectId ZERO_OID = ObjectId::fromHex("0000000000000000000000000000000000000000", 40);
+static constexpr ObjectId INIT_OID = ObjectId::fromHex("4b825dc642cb6eb9a060e54bf8d69288fbee4904", 40);
@@ -0,0 +1,54 @@
+#pragma once
+
+/****************************************************************************************
+ ** GitQlient is an application to manage and operate one or several Git repositories. With
+ ** GitQlient you will be able to add commits, branches and manage all the options Git provides.
+ ** Copyright (C) 2021  Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This program is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QSemaphore>
+#include <QThreadPool>
+
+// Runs function(chunk) for every chunk in [0, chunkCount) across the global thread pool and waits for all of them.
+// Chunks the pool can't take right away run in the calling thread, so a caller that is already in the pool can't
+// starve it.
+template<class Function>
+void parallelFor(int chunkCount, const Function &function)
+{
+   const auto pool = QThreadPool::globalInstance();
+   QSemaphore finished;
+
+   for (auto chunk = 1; chunk < chunkCount; ++chunk)
+   {
+      if (!pool->tryStart([&function, &finished, chunk]() {
+             function(chunk);
+             finished.release();
+          }))
+      {
+         function(chunk);
+         finished.release();
+      }
+   }
+
+   if (chunkCount > 0)
+      function(0);
+
+   finished.acquire(qMax(0, chunkCount - 1));
+}
@@ -147,27 +147,20 @@ void RevisionFiles::setExtStatus(const QString &rowSt, int parNum)
    if (sl.count() != 3)
       return;
 
+   // git give us something like "Rxx\t<orig>\t<dest>"
+   const QString &type = sl[0];
+
+   setExtStatus(sl[1], sl[2], type.mid(1).toInt(), parNum);
+}
+
+void RevisionFiles::setExtStatus(const QString &orig, const QString &dest, int similarity, int parNum)
+{
    // we want store extra info with format "orig --> dest (Rxx%)"
-   // but git give us something like "Rxx\t<orig>\t<dest>"
-   QString type = sl[0];
-   type.remove(0, 1);
-   const QString &orig = sl[1];
-   const QString &dest = sl[2];
-   const QString extStatusInfo(orig + " --> " + dest + " (" + QString::number(type.toInt()) + "%)");
+   const QString extStatusInfo(orig + " --> " + dest + " (" + QString::number(similarity) + "%)");
 
    mFiles.append(dest);
    mergeParent.append(parNum);
    setStatus(RevisionFiles::NEW);
    appendExtStatus(extStatusInfo);
-
-   // simulate deleted orig file only in case of rename
-   if (type.at(0) == 'R')
-   {
-      mFiles.append(orig);
-      mergeParent.append(parNum);
-      setStatus(RevisionFiles::DELETED);
-      appendExtStatus(extStatusInfo);
-   }
-
    setOnlyModified(false);
 }
@@ -43,6 +43,8 @@ public:
    void setOnlyModified(bool onlyModified) { mOnlyModified = onlyModified; }
    int getFilesCount() const { return mFileStatus.size(); }
    void appendExtStatus(const QString &file) { mRenamedFiles.append(file); }
+   // Adds dest as new with the "orig --> dest (xx%)" extended status. The source of a rename isn't listed.
+   void setExtStatus(const QString &orig, const QString &dest, int similarity, int parNum);
    QString getFile(int index) const { return mFiles.at(index); }
    QStringList getFiles() const { return mFiles.toList(); }
    bool containsFile(const QString &fileName) { return mFiles.contains(fileName); }